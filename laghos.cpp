@@ -52,19 +52,42 @@
 
 
 #include "laghos_solver.hpp"
+#include "laghos_timeinteg.hpp"
+#include "laghos_io.hpp"
+#include "laghos_diagnostics.hpp"
+#include "laghos_mesh.hpp"
+#include "laghos_problem.hpp"
 #include <memory>
 #include <iostream>
 #include <fstream>
+#include <cstring>
 
 using namespace std;
 using namespace mfem;
 using namespace mfem::hydrodynamics;
 
-// Choice for the problem setup.
-int problem;
-
 void display_banner(ostream & os);
 
+// Writes the reduced output values of an accepted step: the energy norm of
+// output steps (e_norm_slot >= 0) and the totals of conservation steps.
+static void WriteStepValues(const GlobalReduction &values, int e_norm_slot,
+                            ConservationMonitor *conservation, int ti,
+                            double t, double dt, bool root)
+{
+   if (conservation) { conservation->Write(ti, t, values); }
+   if (e_norm_slot < 0 || !root) { return; }
+   cout << fixed;
+   cout << "step " << setw(5) << ti
+        << ",\tt = " << setw(5) << setprecision(4) << t
+        << ",\tdt = " << setw(5) << setprecision(6) << dt
+        << ",\t|e| = " << setprecision(10)
+        << sqrt(values.Get(e_norm_slot)) << endl;
+}
+
+ParMesh *PartitionMesh(const char *mesh_file, int rs_levels,
+                       int partition_type, bool par_mesh_gen,
+                       PhaseTimer &startup);
+
 int main(int argc, char *argv[])
 {
    // Initialize MPI.
@@ -75,24 +98,41 @@ int main(int argc, char *argv[])
    if (mpi.Root()) { display_banner(cout); }
 
    // Parse command-line options.
+   int problem = 0;
+   double gamma_value = 0.0;
+   double energy_scale = 1.0;
    const char *mesh_file = "data/square01_quad.mesh";
    int rs_levels = 0;
    int rp_levels = 0;
    int order_v = 2;
    int order_e = 1;
    int ode_solver_type = 4;
+   int dt_control = 0;
    double t_final = 0.5;
    double cfl = 0.5;
    double cg_tol = 1e-8;
    int cg_max_iter = 300;
    int max_tsteps = -1;
    bool p_assembly = true;
+   bool quad_float = false;
+   bool force_otf = false;
    bool visualization = false;
    int vis_steps = 5;
    bool visit = false;
    bool gfprint = false;
    const char *basename = "results/Laghos";
+   int num_output_files = 0;
+   int checkpoint_steps = 0;
+   const char *checkpoint_file = "results/Laghos_checkpoint";
+   const char *restart_file = "";
+   int conservation_steps = 0;
+   const char *conservation_file = "results/Laghos_conservation.txt";
    int partition_type = 111;
+   bool par_mesh_gen = true;
+   const char *json_file = "";
+   bool hw_counters = false;
+   const char *trace_file = "";
+   int trace_size = 100000;
 
    OptionsParser args(argc, argv);
    args.AddOption(&mesh_file, "-m", "--mesh",
@@ -102,13 +142,22 @@ int main(int argc, char *argv[])
    args.AddOption(&rp_levels, "-rp", "--refine-parallel",
                   "Number of times to refine the mesh uniformly in parallel.");
    args.AddOption(&problem, "-p", "--problem", "Problem setup to use.");
+   args.AddOption(&gamma_value, "-gam", "--gamma",
+                  "Ideal gas constant of the whole domain (0: the one of the\n\t"
+                  "problem).");
+   args.AddOption(&energy_scale, "-es", "--energy-scale",
+                  "Scale of the initial internal energy (Sedov: blast energy).");
    args.AddOption(&order_v, "-ok", "--order-kinematic",
                   "Order (degree) of the kinematic finite element space.");
    args.AddOption(&order_e, "-ot", "--order-thermo",
                   "Order (degree) of the thermodynamic finite element space.");
    args.AddOption(&ode_solver_type, "-s", "--ode-solver",
                   "ODE solver: 1 - Forward Euler,\n\t"
-                  "            2 - RK2 SSP, 3 - RK3 SSP, 4 - RK4, 6 - RK6.");
+                  "            2 - RK2 SSP, 3 - RK3 SSP, 4 - RK4, 6 - RK6,\n\t"
+                  "            7 - RK2Avg, 8 - low-storage RK3,\n\t"
+                  "            9 - low-storage RK4.");
+   args.AddOption(&dt_control, "-dtc", "--dt-control",
+                  "Time step control: 0 - fixed factors, 1 - predictive.");
    args.AddOption(&t_final, "-tf", "--t-final",
                   "Final time; start time is 0.");
    args.AddOption(&cfl, "-cfl", "--cfl", "CFL-condition number.");
@@ -121,6 +170,14 @@ int main(int argc, char *argv[])
    args.AddOption(&p_assembly, "-pa", "--partial-assembly", "-fa",
                   "--full-assembly",
                   "Activate 1D tensor-based assembly (partial assembly).");
+   args.AddOption(&quad_float, "-qf", "--quad-float", "-no-qf",
+                  "--no-quad-float",
+                  "Store the partial assembly quadrature data in single\n\t"
+                  "precision (the kernels still compute in double).");
+   args.AddOption(&force_otf, "-otf", "--force-on-the-fly", "-no-otf",
+                  "--no-force-on-the-fly",
+                  "Compute the stress inside the partial assembly force\n\t"
+                  "actions instead of storing it at all quadrature points.");
    args.AddOption(&visualization, "-vis", "--visualization", "-no-vis",
                   "--no-visualization",
                   "Enable or disable GLVis visualization.");
@@ -132,6 +189,20 @@ int main(int argc, char *argv[])
                   "Enable or disable result output (files in mfem format).");
    args.AddOption(&basename, "-k", "--outputfilename",
                   "Name of the visit dump files");
+   args.AddOption(&num_output_files, "-nf", "--num-output-files",
+                  "Number of shared files for the -print output, written with\n\t"
+                  "collective MPI-IO (0 means one file per MPI task and field).");
+   args.AddOption(&checkpoint_steps, "-cks", "--checkpoint-steps",
+                  "Write a checkpoint every n-th timestep (0 means never).");
+   args.AddOption(&checkpoint_file, "-ckf", "--checkpoint-file",
+                  "Name of the checkpoint file.");
+   args.AddOption(&restart_file, "-rst", "--restart",
+                  "Restart from the given checkpoint file.");
+   args.AddOption(&conservation_steps, "-cns", "--conservation-steps",
+                  "Record the total mass, momentum and energies every n-th\n\t"
+                  "timestep (0 means never).");
+   args.AddOption(&conservation_file, "-cnf", "--conservation-file",
+                  "Name of the conservation time series file.");
    args.AddOption(&partition_type, "-pt", "--partition",
                   "Customized x/y/z Cartesian MPI partitioning of the serial mesh.\n\t"
                   "Here x,y,z are relative task ratios in each direction.\n\t"
@@ -141,6 +212,22 @@ int main(int argc, char *argv[])
                   "of zones in each direction, e.g., the number of zones in direction x\n\t"
                   "must be divisible by the number of MPI tasks in direction x.\n\t"
                   "Available options: 11, 21, 111, 211, 221, 311, 321, 322, 432.");
+   args.AddOption(&par_mesh_gen, "-pmg", "--par-mesh-gen", "-no-pmg",
+                  "--no-par-mesh-gen",
+                  "Generate Cartesian meshes directly in parallel, instead of\n\t"
+                  "refining and partitioning the full serial mesh on every task.");
+   args.AddOption(&json_file, "-json", "--json-report",
+                  "Write a JSON report with the options, sizes and timings.");
+   args.AddOption(&hw_counters, "-hwc", "--hw-counters", "-no-hwc",
+                  "--no-hw-counters",
+                  "Count hardware events (cycles, instructions, cache misses)\n\t"
+                  "in the major kernels through Linux perf_event_open. Set\n\t"
+                  "LAGHOS_HWC_RAW to a hex perf config to add a raw CPU event.");
+   args.AddOption(&trace_file, "-trace", "--trace-file",
+                  "Write a timeline of the time step phases of all MPI tasks\n\t"
+                  "in the Chrome trace event format (chrome://tracing).");
+   args.AddOption(&trace_size, "-trsz", "--trace-size",
+                  "Number of trace events kept per MPI task (the latest ones).");
    args.Parse();
    if (!args.Good())
    {
@@ -149,103 +236,80 @@ int main(int argc, char *argv[])
    }
    if (mpi.Root()) { args.PrintOptions(cout); }
 
-   // Read the serial mesh from the given mesh file on all processors.
-   // Refine the mesh in serial to increase the resolution.
-   Mesh *mesh = new Mesh(mesh_file, 1, 1);
-   const int dim = mesh->Dimension();
-   for (int lev = 0; lev < rs_levels; lev++) { mesh->UniformRefinement(); }
-
-   if (p_assembly && dim == 1)
+   // Restart from a checkpoint. Restarts on the same number of MPI tasks read
+   // back the local meshes, otherwise the mesh is created and partitioned as
+   // in the original run.
+   PhaseTimer startup;
+   HydroCheckpoint *restart = NULL;
+   if (strlen(restart_file) > 0)
    {
-      p_assembly = false;
+      startup.Start("Checkpoint read");
+      restart = new HydroCheckpoint(MPI_COMM_WORLD, restart_file);
+      const HydroCheckpoint::RunState &rs = restart->GetRunState();
+      MFEM_VERIFY(rs.problem == problem && rs.order_v == order_v &&
+                  rs.order_e == order_e &&
+                  rs.ode_solver_type == ode_solver_type,
+                  "The restart must use the problem, the orders and the ODE "
+                  "solver of the checkpointed run.");
+      MFEM_VERIFY(rs.dt_control == dt_control,
+                  "The restart must use the time step control of the "
+                  "checkpointed run (-dtc " << rs.dt_control << ").");
+      MFEM_VERIFY(rs.gamma_value == gamma_value &&
+                  rs.energy_scale == energy_scale,
+                  "The restart must use the problem parameters of the "
+                  "checkpointed run (-gam " << rs.gamma_value << " -es "
+                  << rs.energy_scale << ").");
       if (mpi.Root())
       {
-         cout << "Laghos does not support PA in 1D. Switching to FA." << endl;
+         cout << "Restarting from " << restart_file << " at step " << rs.ti
+              << ", t = " << rs.t << " (written by " << restart->GetNumProcs()
+              << " MPI tasks)." << endl;
       }
    }
 
-   // Parallel partitioning of the mesh.
    ParMesh *pmesh = NULL;
-   const int num_tasks = mpi.WorldSize(); int unit;
-   int *nxyz = new int[dim];
-   switch (partition_type)
+   if (restart && restart->SameLayout())
    {
-      case 11:
-      case 111:
-         unit = floor(pow(num_tasks, 1.0 / dim) + 1e-2);
-         for (int d = 0; d < dim; d++) { nxyz[d] = unit; }
-         if (dim == 2) { nxyz[2] = 0; }
-         break;
-      case 21: // 2D
-         unit = floor(pow(num_tasks / 2, 1.0 / 2) + 1e-2);
-         nxyz[0] = 2 * unit; nxyz[1] = unit; nxyz[2] = 0;
-         break;
-      case 211: // 3D.
-         unit = floor(pow(num_tasks / 2, 1.0 / 3) + 1e-2);
-         nxyz[0] = 2 * unit; nxyz[1] = unit; nxyz[2] = unit;
-         break;
-      case 221: // 3D.
-         unit = floor(pow(num_tasks / 4, 1.0 / 3) + 1e-2);
-         nxyz[0] = 2 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
-         break;
-      case 311: // 3D.
-         unit = floor(pow(num_tasks / 3, 1.0 / 3) + 1e-2);
-         nxyz[0] = 3 * unit; nxyz[1] = unit; nxyz[2] = unit;
-         break;
-      case 321: // 3D.
-         unit = floor(pow(num_tasks / 6, 1.0 / 3) + 1e-2);
-         nxyz[0] = 3 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
-         break;
-      case 322: // 3D.
-         unit = floor(pow(2 * num_tasks / 3, 1.0 / 3) + 1e-2);
-         nxyz[0] = 3 * unit / 2; nxyz[1] = unit; nxyz[2] = unit;
-         break;
-      case 432: // 3D.
-         unit = floor(pow(num_tasks / 3, 1.0 / 3) + 1e-2);
-         nxyz[0] = 2 * unit; nxyz[1] = 3 * unit / 2; nxyz[2] = unit;
-         break;
-      default:
-         if (myid == 0)
-         {
-            cout << "Unknown partition type: " << partition_type << '\n';
-         }
-         delete mesh;
-         MPI_Finalize();
-         return 3;
+      startup.Start("Checkpoint read");
+      pmesh = restart->ReadMesh();
    }
-   int product = 1;
-   for (int d = 0; d < dim; d++) { product *= nxyz[d]; }
-   if (myid == 0)
+   else
    {
-      cout << nxyz[0] << " " << nxyz[1] << " " << nxyz[2] << " "
-           << product << " " << num_tasks << endl;
+      pmesh = PartitionMesh(mesh_file, rs_levels, partition_type,
+                            par_mesh_gen, startup);
+      if (pmesh == NULL) { return 3; }
+
+      // Refine the mesh further in parallel to increase the resolution.
+      startup.Start("Parallel refinement");
+      for (int lev = 0; lev < rp_levels; lev++) { pmesh->UniformRefinement(); }
    }
-   if (product == num_tasks)
+   const int dim = pmesh->Dimension();
+
+   if (p_assembly && dim == 1)
    {
-      int *partitioning = mesh->CartesianPartitioning(nxyz);
-      pmesh = new ParMesh(MPI_COMM_WORLD, *mesh, partitioning);
-      delete partitioning;
+      p_assembly = false;
+      if (mpi.Root())
+      {
+         cout << "Laghos does not support PA in 1D. Switching to FA." << endl;
+      }
    }
-   else
+   if (quad_float && !p_assembly)
    {
-      if (myid == 0)
+      quad_float = false;
+      if (mpi.Root())
       {
-         cout << "Non-Cartesian partitioning through METIS will be used.\n";
-#ifndef MFEM_USE_METIS
-         cout << "MFEM was built without METIS. "
-              << "Adjust the number of tasks to use a Cartesian split." << endl;
-#endif
+         cout << "Single precision quadrature data needs PA. Using double."
+              << endl;
+      }
+   }
+   if (force_otf && !p_assembly)
+   {
+      force_otf = false;
+      if (mpi.Root())
+      {
+         cout << "The on-the-fly force needs PA. Storing the stress." << endl;
       }
-#ifndef MFEM_USE_METIS
-      return 1;
-#endif
-      pmesh = new ParMesh(MPI_COMM_WORLD, *mesh);
    }
-   delete [] nxyz;
-   delete mesh;
-
-   // Refine the mesh further in parallel to increase the resolution.
-   for (int lev = 0; lev < rp_levels; lev++) { pmesh->UniformRefinement(); }
 
    int nzones = pmesh->GetNE(), nzones_min, nzones_max;
    MPI_Reduce(&nzones, &nzones_min, 1, MPI_INT, MPI_MIN, 0, pmesh->GetComm());
@@ -257,6 +321,7 @@ int main(int argc, char *argv[])
    // Define the parallel finite element spaces. We use:
    // - H1 (Gauss-Lobatto, continuous) for position and velocity.
    // - L2 (Bernstein, discontinuous) for specific internal energy.
+   startup.Start("Finite element spaces");
    L2_FECollection L2FEC(order_e, dim, BasisType::Positive);
    H1_FECollection H1FEC(order_v, dim);
    ParFiniteElementSpace L2FESpace(pmesh, &L2FEC);
@@ -278,14 +343,17 @@ int main(int argc, char *argv[])
    }
 
    // Define the explicit ODE solver used for time integration.
-   ODESolver *ode_solver = NULL;
+   HydroODESolver *ode_solver = NULL;
    switch (ode_solver_type)
    {
-      case 1: ode_solver = new ForwardEulerSolver; break;
-      case 2: ode_solver = new RK2Solver(0.5); break;
-      case 3: ode_solver = new RK3SSPSolver; break;
-      case 4: ode_solver = new RK4Solver; break;
-      case 6: ode_solver = new RK6Solver; break;
+      case 1: ode_solver = new ForwardEulerHydroSolver; break;
+      case 2: ode_solver = new RK2HydroSolver(0.5); break;
+      case 3: ode_solver = new RK3SSPHydroSolver; break;
+      case 4: ode_solver = new RK4HydroSolver; break;
+      case 6: ode_solver = new RK6HydroSolver; break;
+      case 7: ode_solver = new RK2AvgSolver; break;
+      case 8: ode_solver = new LowStorageRKSolver(3); break;
+      case 9: ode_solver = new LowStorageRKSolver(4); break;
       default:
          if (myid == 0)
          {
@@ -296,6 +364,23 @@ int main(int argc, char *argv[])
          return 3;
    }
 
+   // Define the time step control.
+   TimeStepController *dt_controller = NULL;
+   switch (dt_control)
+   {
+      case 0: dt_controller = new FixedFactorController; break;
+      case 1: dt_controller = new PredictiveController; break;
+      default:
+         if (myid == 0)
+         {
+            cout << "Unknown time step control: " << dt_control << '\n';
+         }
+         delete ode_solver;
+         delete pmesh;
+         MPI_Finalize();
+         return 3;
+   }
+
    HYPRE_Int glob_size_l2 = L2FESpace.GlobalTrueVSize();
    HYPRE_Int glob_size_h1 = H1FESpace.GlobalTrueVSize();
 
@@ -335,54 +420,76 @@ int main(int argc, char *argv[])
    // mesh positions to the values in x_gf.
    pmesh->SetNodalGridFunction(&x_gf);
 
-   // Initialize the velocity.
-   VectorFunctionCoefficient v_coeff(pmesh->Dimension(), v0);
-   v_gf.ProjectCoefficient(v_coeff);
-
-   // Initialize density and specific internal energy values. We interpolate in
-   // a non-positive basis to get the correct values at the dofs.  Then we do an
-   // L2 projection to the positive basis in which we actually compute. The goal
-   // is to get a high-order representation of the initial condition. Note that
-   // this density is a temporary function and it will not be updated during the
-   // time evolution.
-   ParGridFunction rho(&L2FESpace);
-   FunctionCoefficient rho_coeff(hydrodynamics::rho0);
-   L2_FECollection l2_fec(order_e, pmesh->Dimension());
-   ParFiniteElementSpace l2_fes(pmesh, &l2_fec);
-   ParGridFunction l2_rho(&l2_fes), l2_e(&l2_fes);
-   l2_rho.ProjectCoefficient(rho_coeff);
-   rho.ProjectGridFunction(l2_rho);
-   if (problem == 1)
-   {
-      // For the Sedov test, we use a delta function at the origin.
-      DeltaCoefficient e_coeff(0, 0, 0.25);
-      l2_e.ProjectCoefficient(e_coeff);
-   }
-   else
+   // Initial mesh positions, needed by the operator setup after a restart and
+   // stored in the checkpoints. The checkpointed state replaces the initial
+   // conditions, but the mesh is kept at its initial positions until the
+   // operator is constructed.
+   Vector x0, x_restart;
+   if (restart)
    {
-      FunctionCoefficient e_coeff(e0);
-      l2_e.ProjectCoefficient(e_coeff);
+      startup.Start("Checkpoint read");
+      restart->ReadState(H1FESpace, L2FESpace, x0, S);
+      x_restart = x_gf;
+      x_gf = x0;
+      pmesh->NewNodes(x_gf, false);
    }
-   e_gf.ProjectGridFunction(l2_e);
+   else if (checkpoint_steps > 0) { x0 = x_gf; }
+
+   // Initialize the velocity, density and specific internal energy values.
+   // After a restart, only the density is needed. Note that this density is a
+   // temporary function and it will not be updated during the time evolution.
+   startup.Start("Initial conditions");
+   ProblemSetup setup(problem);
+   MFEM_VERIFY(setup.Valid(), "Wrong problem specification!");
+   setup.gamma_value = gamma_value;
+   setup.energy_scale = energy_scale;
+   ParGridFunction rho(&L2FESpace);
+   setup.ProjectInitialConditions(rho, restart ? NULL : &v_gf,
+                                  restart ? NULL : &e_gf);
 
    // Space-dependent ideal gas coefficient over the Lagrangian mesh.
-   Coefficient *material_pcf = new FunctionCoefficient(hydrodynamics::gamma);
+   Coefficient *material_pcf =
+      new ProblemCoefficient(setup, ProblemCoefficient::GAMMA);
 
    // Additional details, depending on the problem.
-   int source = 0; bool visc;
-   switch (problem)
-   {
-      case 0: if (pmesh->Dimension() == 2) { source = 1; }
-         visc = false; break;
-      case 1: visc = true; break;
-      case 2: visc = true; break;
-      case 3: visc = true; break;
-      default: MFEM_ABORT("Wrong problem specification!");
-   }
+   const int source = setup.SourceType(pmesh->Dimension());
+   const bool visc = setup.Viscosity();
 
+   startup.Stop();
    LagrangianHydroOperator oper(S.Size(), H1FESpace, L2FESpace,
                                 ess_tdofs, rho, source, cfl, material_pcf,
-                                visc, p_assembly, cg_tol, cg_max_iter);
+                                visc, p_assembly, force_otf,
+                                cg_tol, cg_max_iter);
+   oper.SetSourceScale(setup.SourceScale());
+   if (quad_float) { oper.UseFloatQuadratureData(); }
+
+   if (restart)
+   {
+      // Move the mesh to the checkpointed positions.
+      x_gf = x_restart;
+      pmesh->NewNodes(x_gf, false);
+      DenseMatrix timing_states;
+      restart->ReadTiming(timing_states);
+      oper.SetTimingState(timing_states, restart->SameLayout());
+   }
+
+   if (hw_counters)
+   {
+      int no_hwc = HWCounters::Enable() ? 0 : 1, no_hwc_tasks;
+      MPI_Reduce(&no_hwc, &no_hwc_tasks, 1, MPI_INT, MPI_SUM, 0,
+                 pmesh->GetComm());
+      if (mpi.Root() && no_hwc_tasks > 0)
+      {
+         cout << "Hardware counters are not available on " << no_hwc_tasks
+              << " MPI tasks (see /proc/sys/kernel/perf_event_paranoid)."
+              << endl;
+      }
+   }
+
+   if (strlen(trace_file) > 0)
+   {
+      EventTrace::Enable(pmesh->GetComm(), trace_size);
+   }
 
    socketstream vis_rho, vis_v, vis_e;
    char vishost[] = "localhost";
@@ -427,16 +534,71 @@ int main(int argc, char *argv[])
       visit_dc.Save();
    }
 
+   // Aggregated output of the mesh and the fields into a few shared files.
+   AggregatedOutput *agg_output = NULL;
+   if (gfprint && num_output_files > 0)
+   {
+      agg_output = new AggregatedOutput(*pmesh, num_output_files);
+      agg_output->RegisterField("rho", &rho_gf);
+      agg_output->RegisterField("v", &v_gf);
+      agg_output->RegisterField("e", &e_gf);
+   }
+
    // Perform time-integration (looping over the time iterations, ti, with a
    // time-step dt). The object oper is of type LagrangianHydroOperator that
    // defines the Mult() method that used by the time integrators.
    ode_solver->Init(oper);
-   oper.ResetTimeStepEstimate();
-   double t = 0.0, dt = oper.GetTimeStepEstimate(S), t_old;
+   double t = 0.0, dt, t_old;
+   int steps = 0, ti_start = 1;
+   if (restart)
+   {
+      const HydroCheckpoint::RunState &rs = restart->GetRunState();
+      t = rs.t; dt = rs.dt; steps = rs.steps; ti_start = rs.ti + 1;
+      dt_controller->SetState(rs.dt_control_state);
+      delete restart;
+      restart = NULL;
+   }
+   else
+   {
+      oper.ResetTimeStepEstimate();
+      dt = oper.GetTimeStepEstimate(S);
+   }
    bool last_step = false;
-   int steps = 0;
-   BlockVector S_old(S);
-   for (int ti = 1; !last_step; ti++)
+   int ti_last = ti_start - 1;
+   TimingData &timing = oper.GetTimingData();
+   // The totals of the recorded states are reduced with the time step
+   // estimate of the next step (see step_values below); the initial state is
+   // recorded separately.
+   ConservationMonitor *conservation = NULL;
+   Vector cons_totals;
+   if (conservation_steps > 0)
+   {
+      conservation =
+         new ConservationMonitor(pmesh->GetComm(), dim, conservation_file);
+      GlobalReduction initial_values(pmesh->GetComm());
+      oper.ComputeLocalTotals(S, cons_totals);
+      conservation->Add(cons_totals, initial_values);
+      initial_values.Reduce();
+      conservation->Write(ti_last, t, initial_values);
+   }
+   // Each step writes the new state into S_next, which becomes the current
+   // state only when the step is accepted, so a rejected step needs no copy of
+   // the old state. The first stage reads the buffer of the accepted state, so
+   // it reuses the quadrature data of its time step estimate.
+   BlockVector S_new(true_offset);
+   BlockVector *S_cur = &S, *S_next = &S_new;
+   StopWatch sw_step;
+   // All global values of a step share one reduction: the time step estimate
+   // and the smallest Jacobian determinant of the new state, and the values
+   // of the previous accepted state that are only output, i.e., its energy
+   // norm and conservation totals, which are written one step later. The
+   // values of the last step are reduced at once.
+   GlobalReduction step_values(pmesh->GetComm());
+   int output_ti = -1, e_norm_slot = -1;
+   double output_t = 0.0, output_dt = 0.0, output_e_norm = 0.0;
+   bool output_step = false, output_cons = false;
+   double min_detJ = numeric_limits<double>::infinity();
+   for (int ti = ti_start; !last_step; ti++)
    {
       if (t + dt >= t_final)
       {
@@ -445,53 +607,117 @@ int main(int argc, char *argv[])
       }
       if (steps == max_tsteps) { last_step = true; }
 
-      S_old = S;
       t_old = t;
       oper.ResetTimeStepEstimate();
 
-      // S is the vector of dofs, t is the current time, and dt is the time step
-      // to advance.
-      ode_solver->Step(S, t, dt);
+      // S_cur is the vector of dofs, t is the current time, and dt is the time
+      // step to advance.
+      sw_step.Clear();
+      sw_step.Start();
+      ode_solver->Advance(*S_cur, *S_next, t, dt);
       steps++;
 
       // Adaptive time step control.
-      const double dt_est = oper.GetTimeStepEstimate(S);
-      if (dt_est < dt)
+      step_values.Clear();
+      e_norm_slot = -1;
+      if (output_ti >= 0)
+      {
+         if (output_step) { e_norm_slot = step_values.Sum(output_e_norm); }
+         if (output_cons) { conservation->Add(cons_totals, step_values); }
+      }
+      const double dt_est = oper.GetTimeStepEstimate(*S_next, &step_values);
+      sw_step.Stop();
+
+      if (output_ti >= 0)
+      {
+         WriteStepValues(step_values, e_norm_slot,
+                         output_cons ? conservation : NULL,
+                         output_ti, output_t, output_dt, mpi.Root());
+         output_ti = -1;
+      }
+
+      if (!dt_controller->Update(dt_est, dt))
       {
-         // Repeat (solve again) with a decreased time step - decrease of the
-         // time estimate suggests appearance of oscillations.
-         dt *= 0.85;
          if (dt < numeric_limits<double>::epsilon())
          { MFEM_ABORT("The time step crashed!"); }
          t = t_old;
-         S = S_old;
          oper.ResetQuadratureData();
          if (mpi.Root()) { cout << "Repeating step " << ti << endl; }
+         EventTrace::Mark("Repeated step");
+         timing.rejected_steps++;
+         timing.rejected_time += sw_step.RealTime();
          ti--; continue;
       }
-      else if (dt_est > 1.25 * dt) { dt *= 1.02; }
 
-      // Make sure that the mesh corresponds to the new solution state.
+      // Accept the step: swap the state buffers and point the fields to the
+      // new state. Make sure that the mesh corresponds to the new state.
+      BlockVector *S_tmp = S_cur;
+      S_cur = S_next;
+      S_next = S_tmp;
+      x_gf.MakeRef(&H1FESpace, *S_cur, true_offset[0]);
+      v_gf.MakeRef(&H1FESpace, *S_cur, true_offset[1]);
+      e_gf.MakeRef(&L2FESpace, *S_cur, true_offset[2]);
       pmesh->NewNodes(x_gf, false);
-
-      if (last_step || (ti % vis_steps) == 0)
+      ti_last = ti;
+      min_detJ = min(min_detJ, oper.GetMinDetJ());
+
+      // The local output values of the new state.
+      output_step = last_step || (ti % vis_steps) == 0;
+      output_cons = conservation &&
+                    (last_step || (ti % conservation_steps) == 0);
+      if (output_step || output_cons)
       {
-         double loc_norm = e_gf * e_gf, tot_norm;
-         MPI_Allreduce(&loc_norm, &tot_norm, 1, MPI_DOUBLE, MPI_SUM,
-                       pmesh->GetComm());
-         if (mpi.Root())
+         if (output_step)
+         {
+            const Vector &e_cur = S_cur->GetBlock(2);
+            output_e_norm = e_cur * e_cur;
+         }
+         if (output_cons) { oper.ComputeLocalTotals(*S_cur, cons_totals); }
+         output_ti = ti; output_t = t; output_dt = dt;
+         if (last_step)
          {
-            cout << fixed;
-            cout << "step " << setw(5) << ti
-                 << ",\tt = " << setw(5) << setprecision(4) << t
-                 << ",\tdt = " << setw(5) << setprecision(6) << dt
-                 << ",\t|e| = " << setprecision(10)
-                 << sqrt(tot_norm) << endl;
+            step_values.Clear();
+            e_norm_slot = -1;
+            if (output_step) { e_norm_slot = step_values.Sum(output_e_norm); }
+            if (output_cons) { conservation->Add(cons_totals, step_values); }
+            step_values.Reduce();
+            WriteStepValues(step_values, e_norm_slot,
+                            output_cons ? conservation : NULL,
+                            output_ti, output_t, output_dt, mpi.Root());
+            output_ti = -1;
          }
+      }
+
+      if (checkpoint_steps > 0 && (ti % checkpoint_steps == 0 || last_step))
+      {
+         HydroCheckpoint::RunState rs;
+         rs.problem = problem;
+         rs.order_v = order_v;
+         rs.order_e = order_e;
+         rs.ode_solver_type = ode_solver_type;
+         rs.ti = ti; rs.steps = steps;
+         rs.t = t;   rs.dt = dt;
+         rs.dt_control = dt_control;
+         rs.dt_control_state = dt_controller->GetState();
+         rs.gamma_value = gamma_value;
+         rs.energy_scale = energy_scale;
+         Vector timing_state;
+         oper.GetTimingState(timing_state);
+         EventTrace::Begin("Checkpoint");
+         HydroCheckpoint::Write(checkpoint_file, rs, H1FESpace, L2FESpace,
+                                x0, *S_cur, timing_state);
+         EventTrace::End();
+      }
+
+      if (output_step)
+      {
+         KernelTimer &sw_output = oper.GetTimingData().sw_output;
+         EventTrace::Begin("Output");
+         sw_output.Start();
 
          // Make sure all ranks have sent their 'v' solution before initiating
          // another set of GLVis connections (one from each rank):
-         MPI_Barrier(pmesh->GetComm());
+         if (visualization) { MPI_Barrier(pmesh->GetComm()); }
 
          if (visualization || visit || gfprint) { oper.ComputeDensity(rho_gf); }
          if (visualization)
@@ -518,7 +744,8 @@ int main(int argc, char *argv[])
             visit_dc.Save();
          }
 
-         if (gfprint)
+         if (agg_output) { agg_output->Save(basename, ti, t); }
+         else if (gfprint)
          {
             ostringstream mesh_name, rho_name, v_name, e_name;
             mesh_name << basename << "_" << ti
@@ -550,17 +777,109 @@ int main(int argc, char *argv[])
             e_gf.Save(e_ofs);
             e_ofs.close();
          }
+         sw_output.Stop();
+         EventTrace::End();
       }
    }
 
+   int stages = 1;
    switch (ode_solver_type)
    {
-      case 2: steps *= 2; break;
-      case 3: steps *= 3; break;
-      case 4: steps *= 4; break;
-      case 6: steps *= 6;
+      case 2: stages = 2; break;
+      case 3: stages = 3; break;
+      case 4: stages = 4; break;
+      case 6: stages = 6; break;
+      case 7: stages = 2; break;
+      case 8: stages = 3; break;
+      case 9: stages = 5;
+   }
+   steps *= stages;
+
+   // RK stages spent in rejected steps, and all stages per unit of simulated
+   // time (the restarted part of a run included).
+   const int wasted_stages = timing.rejected_steps * stages;
+   const double stages_per_time = (t > 0.0) ? steps / t : 0.0;
+   if (mpi.Root())
+   {
+      cout << endl << "Time step control (" << dt_controller->Name() << "): "
+           << timing.rejected_steps << " rejected steps, " << wasted_stages
+           << " wasted RK stages, " << stages_per_time
+           << " RK stages per unit time." << endl;
+      if (min_detJ < numeric_limits<double>::infinity())
+      {
+         cout << "Smallest Jacobian determinant of the accepted states: "
+              << min_detJ << "." << endl;
+      }
+      if (conservation)
+      {
+         cout << "Total energy: relative change "
+              << conservation->EnergyChange() << " (time series in "
+              << conservation_file << ")." << endl;
+      }
+   }
+
+   JSONWriter *json = NULL;
+   ofstream json_ofs;
+   if (mpi.Root() && strlen(json_file) > 0)
+   {
+      json_ofs.open(json_file);
+      json = new JSONWriter(json_ofs);
+      json->BeginObject();
+      json->BeginObject("options");
+      json->Add("mesh", mesh_file);
+      json->Add("refine_serial", rs_levels);
+      json->Add("refine_parallel", rp_levels);
+      json->Add("problem", problem);
+      json->Add("gamma", gamma_value);
+      json->Add("energy_scale", energy_scale);
+      json->Add("order_kinematic", order_v);
+      json->Add("order_thermo", order_e);
+      json->Add("ode_solver", ode_solver_type);
+      json->Add("dt_control", dt_control);
+      json->Add("t_final", t_final);
+      json->Add("cfl", cfl);
+      json->Add("cg_tol", cg_tol);
+      json->Add("cg_max_steps", cg_max_iter);
+      json->Add("max_steps", max_tsteps);
+      json->Add("partial_assembly", p_assembly);
+      json->Add("quad_float", quad_float);
+      json->Add("force_on_the_fly", force_otf);
+      json->Add("partition", partition_type);
+      json->Add("par_mesh_gen", par_mesh_gen);
+      json->Add("hw_counters", hw_counters);
+      json->Add("trace_file", trace_file);
+      json->Add("restart", restart_file);
+      json->Add("conservation_steps", conservation_steps);
+      json->EndObject();
+      json->BeginObject("run");
+      json->Add("time_steps", ti_last);
+      json->Add("repeated_steps", timing.rejected_steps);
+      json->Add("wasted_stages", wasted_stages);
+      json->Add("stages_per_time", stages_per_time);
+      if (min_detJ < numeric_limits<double>::infinity())
+      {
+         json->Add("min_detJ", min_detJ);
+      }
+      if (conservation)
+      {
+         json->Add("energy_change", conservation->EnergyChange());
+      }
+      json->Add("final_time", t);
+      json->Add("final_dt", dt);
+      json->EndObject();
+   }
+   oper.PrintTimingData(mpi.Root(), steps, &startup, json);
+   if (json)
+   {
+      json->EndObject();
+      delete json;
+   }
+   HWCounters::Disable();
+   if (EventTrace::Enabled())
+   {
+      EventTrace::Write(trace_file);
+      EventTrace::Disable();
    }
-   oper.PrintTimingData(mpi.Root(), steps);
 
    if (visualization)
    {
@@ -569,6 +888,9 @@ int main(int argc, char *argv[])
    }
 
    // Free the used memory.
+   delete agg_output;
+   delete conservation;
+   delete dt_controller;
    delete ode_solver;
    delete pmesh;
    delete material_pcf;
@@ -576,92 +898,124 @@ int main(int argc, char *argv[])
    return 0;
 }
 
-namespace mfem
-{
-
-namespace hydrodynamics
+// Reads the serial mesh from the given mesh file on all processors, refines it
+// rs_levels times and partitions it. Axis-aligned tensor-product meshes with a
+// Cartesian partitioning are refined and partitioned directly in parallel when
+// par_mesh_gen is set. Returns NULL when the requested partitioning can't be
+// used.
+ParMesh *PartitionMesh(const char *mesh_file, int rs_levels,
+                       int partition_type, bool par_mesh_gen,
+                       PhaseTimer &startup)
 {
+   // Read the serial mesh from the given mesh file on all processors.
+   startup.Start("Mesh read");
+   Mesh *mesh = new Mesh(mesh_file, 1, 1);
+   const int dim = mesh->Dimension();
 
-double rho0(const Vector &x)
-{
-   switch (problem)
+   // Parallel partitioning of the mesh.
+   ParMesh *pmesh = NULL;
+   int myid, num_tasks, unit;
+   MPI_Comm_rank(MPI_COMM_WORLD, &myid);
+   MPI_Comm_size(MPI_COMM_WORLD, &num_tasks);
+   int nxyz[3] = {0, 0, 0};
+   switch (partition_type)
    {
-      case 0: return 1.0;
-      case 1: return 1.0;
-      case 2: if (x(0) < 0.5) { return 1.0; }
-         else { return 0.1; }
-      case 3: if (x(0) > 1.0 && x(1) <= 1.5) { return 1.0; }
-         else { return 0.125; }
-      default: MFEM_ABORT("Bad number given for problem id!"); return 0.0;
+      case 11:
+      case 111:
+         unit = floor(pow(num_tasks, 1.0 / dim) + 1e-2);
+         for (int d = 0; d < dim; d++) { nxyz[d] = unit; }
+         if (dim == 2) { nxyz[2] = 0; }
+         break;
+      case 21: // 2D
+         unit = floor(pow(num_tasks / 2, 1.0 / 2) + 1e-2);
+         nxyz[0] = 2 * unit; nxyz[1] = unit; nxyz[2] = 0;
+         break;
+      case 211: // 3D.
+         unit = floor(pow(num_tasks / 2, 1.0 / 3) + 1e-2);
+         nxyz[0] = 2 * unit; nxyz[1] = unit; nxyz[2] = unit;
+         break;
+      case 221: // 3D.
+         unit = floor(pow(num_tasks / 4, 1.0 / 3) + 1e-2);
+         nxyz[0] = 2 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
+         break;
+      case 311: // 3D.
+         unit = floor(pow(num_tasks / 3, 1.0 / 3) + 1e-2);
+         nxyz[0] = 3 * unit; nxyz[1] = unit; nxyz[2] = unit;
+         break;
+      case 321: // 3D.
+         unit = floor(pow(num_tasks / 6, 1.0 / 3) + 1e-2);
+         nxyz[0] = 3 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
+         break;
+      case 322: // 3D.
+         unit = floor(pow(2 * num_tasks / 3, 1.0 / 3) + 1e-2);
+         nxyz[0] = 3 * unit / 2; nxyz[1] = unit; nxyz[2] = unit;
+         break;
+      case 432: // 3D.
+         unit = floor(pow(num_tasks / 3, 1.0 / 3) + 1e-2);
+         nxyz[0] = 2 * unit; nxyz[1] = 3 * unit / 2; nxyz[2] = unit;
+         break;
+      default:
+         if (myid == 0)
+         {
+            cout << "Unknown partition type: " << partition_type << '\n';
+         }
+         delete mesh;
+         return NULL;
    }
-}
-
-double gamma(const Vector &x)
-{
-   switch (problem)
+   int product = 1;
+   for (int d = 0; d < dim; d++) { product *= nxyz[d]; }
+   if (myid == 0)
    {
-      case 0: return 5./3.;
-      case 1: return 1.4;
-      case 2: return 1.4;
-      case 3: if (x(0) > 1.0 && x(1) <= 1.5) { return 1.4; }
-         else { return 1.5; }
-      default: MFEM_ABORT("Bad number given for problem id!"); return 0.0;
+      cout << nxyz[0] << " " << nxyz[1] << " " << nxyz[2] << " "
+           << product << " " << num_tasks << endl;
    }
-}
-
-void v0(const Vector &x, Vector &v)
-{
-   switch (problem)
+   if (product == num_tasks)
    {
-      case 0:
-         v(0) =  sin(M_PI*x(0)) * cos(M_PI*x(1));
-         v(1) = -cos(M_PI*x(0)) * sin(M_PI*x(1));
-         if (x.Size() == 3)
+      // Every task generates only its own part of the refined mesh.
+      CartesianMeshGenerator generator;
+      if (par_mesh_gen && generator.Init(*mesh))
+      {
+         startup.Start("Parallel mesh generation");
+         generator.Refine(rs_levels);
+         pmesh = generator.MakeParMesh(MPI_COMM_WORLD, nxyz);
+         if (pmesh && myid == 0)
          {
-            v(0) *= cos(M_PI*x(2));
-            v(1) *= cos(M_PI*x(2));
-            v(2) = 0.0;
+            cout << "Cartesian mesh generated in parallel." << endl;
          }
-         break;
-      case 1: v = 0.0; break;
-      case 2: v = 0.0; break;
-      case 3: v = 0.0; break;
-      default: MFEM_ABORT("Bad number given for problem id!");
+      }
    }
-}
+   if (pmesh) { delete mesh; return pmesh; }
 
-double e0(const Vector &x)
-{
-   switch (problem)
+   // Refine the mesh in serial to increase the resolution.
+   startup.Start("Serial refinement");
+   for (int lev = 0; lev < rs_levels; lev++) { mesh->UniformRefinement(); }
+   startup.Start("Mesh partitioning");
+   if (product == num_tasks)
+   {
+      int *partitioning = mesh->CartesianPartitioning(nxyz);
+      pmesh = new ParMesh(MPI_COMM_WORLD, *mesh, partitioning);
+      delete partitioning;
+   }
+   else
    {
-      case 0:
+      if (myid == 0)
       {
-         const double denom = 2.0 / 3.0;  // (5/3 - 1) * density.
-         double val;
-         if (x.Size() == 2)
-         {
-            val = 1.0 + (cos(2*M_PI*x(0)) + cos(2*M_PI*x(1))) / 4.0;
-         }
-         else
-         {
-            val = 100.0 + ((cos(2*M_PI*x(2)) + 2) *
-                           (cos(2*M_PI*x(0)) + cos(2*M_PI*x(1))) - 2) / 16.0;
-         }
-         return val/denom;
+         cout << "Non-Cartesian partitioning through METIS will be used.\n";
+#ifndef MFEM_USE_METIS
+         cout << "MFEM was built without METIS. "
+              << "Adjust the number of tasks to use a Cartesian split." << endl;
+#endif
       }
-      case 1: return 0.0; // This case in initialized in main().
-      case 2: if (x(0) < 0.5) { return 1.0 / rho0(x) / (gamma(x) - 1.0); }
-         else { return 0.1 / rho0(x) / (gamma(x) - 1.0); }
-      case 3: if (x(0) > 1.0) { return 0.1 / rho0(x) / (gamma(x) - 1.0); }
-         else { return 1.0 / rho0(x) / (gamma(x) - 1.0); }
-      default: MFEM_ABORT("Bad number given for problem id!"); return 0.0;
+#ifndef MFEM_USE_METIS
+      delete mesh;
+      return NULL;
+#endif
+      pmesh = new ParMesh(MPI_COMM_WORLD, *mesh);
    }
+   delete mesh;
+   return pmesh;
 }
 
-} // namespace hydrodynamics
-
-} // namespace mfem
-
 void display_banner(ostream & os)
 {
    os << endl
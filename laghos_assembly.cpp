@@ -16,8 +16,6 @@
 
 #include "laghos_assembly.hpp"
 
-#ifdef MFEM_USE_MPI
-
 using namespace std;
 
 namespace mfem
@@ -26,8 +24,57 @@ namespace mfem
 namespace hydrodynamics
 {
 
-const Tensors1D *tensors1D = NULL;
-const FastEvaluator *evaluator = NULL;
+void QuadratureData::SetFloat()
+{
+   if (use_float) { return; }
+   if (store_stress)
+   {
+      const int n = stressJinvT.SizeI() * stressJinvT.SizeJ() *
+                    stressJinvT.SizeK();
+      stressJinvT_f.resize(n);
+      const double *s = stressJinvT.Data();
+      for (int i = 0; i < n; i++) { stressJinvT_f[i] = (float) s[i]; }
+      stressJinvT.UseExternalData(NULL, 0, 0, 0);
+   }
+   rho0DetJ0w_f.resize(rho0DetJ0w.Size());
+   for (int i = 0; i < rho0DetJ0w.Size(); i++)
+   {
+      rho0DetJ0w_f[i] = (float) rho0DetJ0w(i);
+   }
+   use_float = true;
+}
+
+void QuadratureData::ScaleByStress(int vd, int gd, int z, int nqp,
+                                   const double *x, double *y) const
+{
+   const int dim = Jac0inv.SizeI(), n = rho0DetJ0w.Size();
+   const int offset = (vd*dim + gd)*n + z*nqp;
+   if (use_float)
+   {
+      const float *d = &stressJinvT_f[offset];
+      for (int q = 0; q < nqp; q++) { y[q] = x[q] * d[q]; }
+   }
+   else
+   {
+      const double *d = stressJinvT(vd).Data() + gd*n + z*nqp;
+      for (int q = 0; q < nqp; q++) { y[q] = x[q] * d[q]; }
+   }
+}
+
+void QuadratureData::ScaleByMass(int z, int nqp,
+                                 const double *x, double *y) const
+{
+   if (use_float)
+   {
+      const float *d = &rho0DetJ0w_f[z*nqp];
+      for (int q = 0; q < nqp; q++) { y[q] = x[q] * d[q]; }
+   }
+   else
+   {
+      const double *d = rho0DetJ0w.GetData() + z*nqp;
+      for (int q = 0; q < nqp; q++) { y[q] = x[q] * d[q]; }
+   }
+}
 
 Tensors1D::Tensors1D(int H1order, int L2order, int nqp1D)
    : HQshape1D(H1order + 1, nqp1D),
@@ -57,29 +104,44 @@ Tensors1D::Tensors1D(int H1order, int L2order, int nqp1D)
    }
 }
 
-void FastEvaluator::GetL2Values(const Vector &vecL2, Vector &vecQ) const
+// Flops of the sum factorization that maps the n_in^dim values of a tensor to
+// n_out^dim values by contracting one direction at a time.
+static double ContractFlops(int dim, int n_in, int n_out)
 {
-   const int nL2dof1D = tensors1D->LQshape1D.Height(),
-             nqp1D    = tensors1D->LQshape1D.Width();
+   double flops = 0.0;
+   for (int k = 1; k <= dim; k++)
+   {
+      flops += 2.0 * pow(n_in, dim - k + 1) * pow(n_out, k);
+   }
+   return flops;
+}
+
+// Values at the quadrature points of a tensor-product function in dim
+// dimensions, given by its n^dim lexicographically ordered dofs, where the
+// 1D basis functions at the 1D quadrature points are shape1D (n x nqp1D).
+static void TensorValues(int dim, const DenseMatrix &shape1D,
+                         const Vector &vec, Vector &vecQ)
+{
+   const int ndof1D = shape1D.Height(), nqp1D = shape1D.Width();
    if (dim == 2)
    {
-      DenseMatrix E(vecL2.GetData(), nL2dof1D, nL2dof1D);
-      DenseMatrix LQ(nL2dof1D, nqp1D);
+      DenseMatrix E(vec.GetData(), ndof1D, ndof1D);
+      DenseMatrix LQ(ndof1D, nqp1D);
 
       vecQ.SetSize(nqp1D * nqp1D);
       DenseMatrix QQ(vecQ.GetData(), nqp1D, nqp1D);
 
       // LQ_j2_k1 = E_j1_j2 LQs_j1_k1  -- contract in x direction.
       // QQ_k1_k2 = LQ_j2_k1 LQs_j2_k2 -- contract in y direction.
-      MultAtB(E, tensors1D->LQshape1D, LQ);
-      MultAtB(LQ, tensors1D->LQshape1D, QQ);
+      MultAtB(E, shape1D, LQ);
+      MultAtB(LQ, shape1D, QQ);
    }
    else
    {
-      DenseMatrix E(vecL2.GetData(), nL2dof1D*nL2dof1D, nL2dof1D);
-      DenseMatrix LL_Q(nL2dof1D * nL2dof1D, nqp1D),
-                  L_LQ(LL_Q.GetData(), nL2dof1D, nL2dof1D*nqp1D),
-                  Q_LQ(nqp1D, nL2dof1D*nqp1D);
+      DenseMatrix E(vec.GetData(), ndof1D*ndof1D, ndof1D);
+      DenseMatrix LL_Q(ndof1D * ndof1D, nqp1D),
+                  L_LQ(LL_Q.GetData(), ndof1D, ndof1D*nqp1D),
+                  Q_LQ(nqp1D, ndof1D*nqp1D);
 
       vecQ.SetSize(nqp1D * nqp1D * nqp1D);
       DenseMatrix QQ_Q(vecQ.GetData(), nqp1D * nqp1D, nqp1D);
@@ -88,8 +150,8 @@ void FastEvaluator::GetL2Values(const Vector &vecL2, Vector &vecQ) const
       // QLQ_k1_j2_k3  = LQs_j1_k1 LLQ_j1_j2_k3 -- contract in x direction.
       // QQQ_k1_k2_k3  = QLQ_k1_j2_k3 LQs_j2_k2 -- contract in y direction.
       // The last step does some reordering (it's not product of matrices).
-      mfem::Mult(E, tensors1D->LQshape1D, LL_Q);
-      MultAtB(tensors1D->LQshape1D, L_LQ, Q_LQ);
+      mfem::Mult(E, shape1D, LL_Q);
+      MultAtB(shape1D, L_LQ, Q_LQ);
       for (int k1 = 0; k1 < nqp1D; k1++)
       {
          for (int k2 = 0; k2 < nqp1D; k2++)
@@ -97,10 +159,10 @@ void FastEvaluator::GetL2Values(const Vector &vecL2, Vector &vecQ) const
             for (int k3 = 0; k3 < nqp1D; k3++)
             {
                QQ_Q(k1 + nqp1D*k2, k3) = 0.0;
-               for (int j2 = 0; j2 < nL2dof1D; j2++)
+               for (int j2 = 0; j2 < ndof1D; j2++)
                {
                   QQ_Q(k1 + nqp1D*k2, k3) +=
-                     Q_LQ(k1, j2 + k3*nL2dof1D) * tensors1D->LQshape1D(j2, k2);
+                     Q_LQ(k1, j2 + k3*ndof1D) * shape1D(j2, k2);
                }
             }
          }
@@ -108,6 +170,11 @@ void FastEvaluator::GetL2Values(const Vector &vecL2, Vector &vecQ) const
    }
 }
 
+void FastEvaluator::GetL2Values(const Vector &vecL2, Vector &vecQ) const
+{
+   TensorValues(dim, tensors1D->LQshape1D, vecL2, vecQ);
+}
+
 void FastEvaluator::GetVectorGrad(const DenseMatrix &vec, DenseTensor &J) const
 {
    const int nH1dof1D = tensors1D->HQshape1D.Height(),
@@ -286,6 +353,138 @@ void FastEvaluator::GetVectorGrad(const DenseMatrix &vec, DenseTensor &J) const
    }
 }
 
+void FastEvaluator::GetZoneValues(const Vector &vecL2, Vector &vecQ, int nvec,
+                                  const DenseMatrix *vec, DenseTensor *J,
+                                  DenseMatrix *vals) const
+{
+   GetL2Values(vecL2, vecQ);
+
+   const DenseMatrix &HQs = tensors1D->HQshape1D, &HQg = tensors1D->HQgrad1D;
+   const int nH1dof1D = HQs.Height(), nqp1D = HQs.Width();
+   const int ncomp = nvec * dim, nH1dof = vec[0].Height();
+   const FiniteElement *fe = H1FESpace.GetFE(0);
+   const Array<int> &dof_map = (dim == 2) ?
+      dynamic_cast<const H1_QuadrilateralElement *>(fe)->GetDofMap() :
+      dynamic_cast<const H1_HexahedronElement *>(fe)->GetDofMap();
+
+   // Transfer all components of all fields from the mfem's H1 local numbering
+   // to the tensor structure numbering.
+   // In 2D the components are blocks of nH1dof values; in 3D the blocks are
+   // the (x, y) slices, with the components of a slice next to each other.
+   const int slice = (dim == 2) ? nH1dof : nH1dof1D * nH1dof1D;
+   Vector x(nH1dof * ncomp);
+   for (int f = 0; f < nvec; f++)
+   {
+      for (int c = 0; c < dim; c++)
+      {
+         const int comp = f*dim + c;
+         for (int j = 0; j < nH1dof; j++)
+         {
+            const int s = j / slice;
+            x(j + slice * (comp + s * (ncomp - 1))) = vec[f](dof_map[j], c);
+         }
+      }
+      J[f].SetSize(dim, dim, (dim == 2) ? nqp1D*nqp1D : nqp1D*nqp1D*nqp1D);
+   }
+   if (vals) { vals->SetSize(J[0].SizeK(), dim); }
+
+   if (dim == 2)
+   {
+      // The components are the column blocks of X, X_i1_(i2,c).
+      DenseMatrix X(x.GetData(), nH1dof1D, nH1dof1D * ncomp),
+                  HQ_s(nH1dof1D * ncomp, nqp1D), HQ_g(nH1dof1D * ncomp, nqp1D);
+
+      // HQ_(i2,c)_k1 = X_i1_(i2,c) HQs_i1_k1 -- contract  in x direction.
+      // HQ_(i2,c)_k1 = X_i1_(i2,c) HQg_i1_k1 -- gradients in x direction.
+      MultAtB(X, HQs, HQ_s);
+      MultAtB(X, HQg, HQ_g);
+
+      // QQ_k1_k2 = HQ_i2_k1 HQ(s|g)_i2_k2 -- contract / gradients in y
+      // direction, for each component.
+      for (int f = 0; f < nvec; f++)
+      {
+         for (int c = 0; c < dim; c++)
+         {
+            const int i0 = (f*dim + c) * nH1dof1D;
+            for (int k2 = 0; k2 < nqp1D; k2++)
+            {
+               for (int k1 = 0; k1 < nqp1D; k1++)
+               {
+                  double gx = 0.0, gy = 0.0, u = 0.0;
+                  for (int i2 = 0; i2 < nH1dof1D; i2++)
+                  {
+                     gx += HQ_g(i0 + i2, k1) * HQs(i2, k2);
+                     gy += HQ_s(i0 + i2, k1) * HQg(i2, k2);
+                     u  += HQ_s(i0 + i2, k1) * HQs(i2, k2);
+                  }
+                  const int idx = k2 * nqp1D + k1;
+                  J[f](idx)(c, 0) = gx;
+                  J[f](idx)(c, 1) = gy;
+                  if (f == 0 && vals) { (*vals)(idx, c) = u; }
+               }
+            }
+         }
+      }
+   }
+   else
+   {
+      // The components are the row blocks of X, X_(i1,i2,c)_i3.
+      const int nH1dof2D = nH1dof1D * nH1dof1D;
+      DenseMatrix X(x.GetData(), nH1dof2D * ncomp, nH1dof1D),
+                  HH_Qs(nH1dof2D * ncomp, nqp1D),
+                  HH_Qg(nH1dof2D * ncomp, nqp1D),
+                  H_HQs(HH_Qs.GetData(), nH1dof1D, nH1dof1D*ncomp*nqp1D),
+                  H_HQg(HH_Qg.GetData(), nH1dof1D, nH1dof1D*ncomp*nqp1D),
+                  Q_HQgs(nqp1D, nH1dof1D*ncomp*nqp1D),
+                  Q_HQss(nqp1D, nH1dof1D*ncomp*nqp1D),
+                  Q_HQsg(nqp1D, nH1dof1D*ncomp*nqp1D);
+
+      // HHQ_(i1,i2,c)_k3 = X_(i1,i2,c)_i3 HQ(s|g)_i3_k3 -- contract /
+      // gradients in z direction.
+      mfem::Mult(X, HQs, HH_Qs);
+      mfem::Mult(X, HQg, HH_Qg);
+
+      // QHQ_k1_(i2,c,k3) = HQ(g|s)_i1_k1 HHQ_i1_(i2,c,k3) -- gradients /
+      // contract in x direction.
+      MultAtB(HQg, H_HQs, Q_HQgs);
+      MultAtB(HQs, H_HQs, Q_HQss);
+      MultAtB(HQs, H_HQg, Q_HQsg);
+
+      // QQQ_k1_k2_k3 = QHQ_k1_(i2,c,k3) HQ(s|g)_i2_k2 -- contract / gradients
+      // in y direction, for each component.
+      for (int f = 0; f < nvec; f++)
+      {
+         for (int c = 0; c < dim; c++)
+         {
+            const int comp = f*dim + c;
+            for (int k3 = 0; k3 < nqp1D; k3++)
+            {
+               const int j0 = (comp + k3 * ncomp) * nH1dof1D;
+               for (int k2 = 0; k2 < nqp1D; k2++)
+               {
+                  for (int k1 = 0; k1 < nqp1D; k1++)
+                  {
+                     double gx = 0.0, gy = 0.0, gz = 0.0, u = 0.0;
+                     for (int i2 = 0; i2 < nH1dof1D; i2++)
+                     {
+                        gx += Q_HQgs(k1, j0 + i2) * HQs(i2, k2);
+                        gy += Q_HQss(k1, j0 + i2) * HQg(i2, k2);
+                        gz += Q_HQsg(k1, j0 + i2) * HQs(i2, k2);
+                        u  += Q_HQss(k1, j0 + i2) * HQs(i2, k2);
+                     }
+                     const int idx = k3*nqp1D*nqp1D + k2*nqp1D + k1;
+                     J[f](idx)(c, 0) = gx;
+                     J[f](idx)(c, 1) = gy;
+                     J[f](idx)(c, 2) = gz;
+                     if (f == 0 && vals) { (*vals)(idx, c) = u; }
+                  }
+               }
+            }
+         }
+      }
+   }
+}
+
 void DensityIntegrator::AssembleRHSElementVect(const FiniteElement &fe,
                                                ElementTransformation &Tr,
                                                Vector &elvect)
@@ -346,22 +545,119 @@ void ForceIntegrator::AssembleElementMatrix2(const FiniteElement &trial_fe,
    }
 }
 
+KernelCost FastEvaluator::GetL2ValuesCost() const
+{
+   const int nL2dof1D = tensors1D->LQshape1D.Height(),
+             nqp1D    = tensors1D->LQshape1D.Width();
+   const double nL2dof = pow(nL2dof1D, dim), nqp = pow(nqp1D, dim);
+   return KernelCost(ContractFlops(dim, nL2dof1D, nqp1D),
+                     sizeof(double) * (nL2dof + nqp));
+}
+
+KernelCost FastEvaluator::GetZoneValuesCost(int nvec, bool values) const
+{
+   const double n = tensors1D->HQshape1D.Height(),
+                q = tensors1D->HQshape1D.Width();
+   const double nH1dof = pow(n, dim), nqp = pow(q, dim), ncomp = nvec * dim;
+   // The z (3D) or x (2D) contractions with the shape functions and their
+   // gradients, the x contractions of 3D, and the last contractions, which
+   // give dim gradients and, with values, one more result per component.
+   double flops = 2.0 * 2.0 * nH1dof * q;
+   if (dim == 3) { flops += 3.0 * 2.0 * n * n * q * q; }
+   flops += (dim + (values ? 1.0 : 0.0)) * 2.0 * n * nqp;
+   const double results = ncomp * dim + (values ? dim : 0.0);
+   KernelCost cost(ncomp * flops,
+                   sizeof(double) * (ncomp * nH1dof + results * nqp));
+   cost += GetL2ValuesCost();
+   return cost;
+}
+
+KernelCost FastEvaluator::GetVectorGradCost() const
+{
+   const int nH1dof1D = tensors1D->HQshape1D.Height(),
+             nqp1D    = tensors1D->HQshape1D.Width();
+   const double nH1dof = pow(nH1dof1D, dim), nqp = pow(nqp1D, dim);
+   return KernelCost(dim * dim * ContractFlops(dim, nH1dof1D, nqp1D),
+                     sizeof(double) * dim * (nH1dof + dim * nqp));
+}
+
 void ForcePAOperator::Mult(const Vector &vecL2, Vector &vecH1) const
 {
-   if      (dim == 2) { MultQuad(vecL2, vecH1); }
-   else if (dim == 3) { MultHex(vecL2, vecH1); }
-   else { MFEM_ABORT("Unsupported dimension"); }
+   vecH1 = 0.0;
+   AddMultZones(*quad_data, 0, nzones, vecL2, vecH1);
 }
 
 void ForcePAOperator::MultTranspose(const Vector &vecH1, Vector &vecL2) const
 {
-   if      (dim == 2) { MultTransposeQuad(vecH1, vecL2); }
-   else if (dim == 3) { MultTransposeHex(vecH1, vecL2); }
+   MultTransposeZones(*quad_data, 0, nzones, vecH1, vecL2);
+}
+
+void ForcePAOperator::AddMultZones(const QuadratureData &zone_data,
+                                   int z_first, int nz, const Vector &vecL2,
+                                   Vector &vecH1) const
+{
+   if      (dim == 2) { MultQuad(zone_data, z_first, nz, vecL2, vecH1); }
+   else if (dim == 3) { MultHex(zone_data, z_first, nz, vecL2, vecH1); }
    else { MFEM_ABORT("Unsupported dimension"); }
 }
 
+void ForcePAOperator::MultTransposeZones(const QuadratureData &zone_data,
+                                         int z_first, int nz,
+                                         const Vector &vecH1,
+                                         Vector &vecL2) const
+{
+   if (dim == 2)
+   {
+      MultTransposeQuad(zone_data, z_first, nz, vecH1, vecL2);
+   }
+   else if (dim == 3)
+   {
+      MultTransposeHex(zone_data, z_first, nz, vecH1, vecL2);
+   }
+   else { MFEM_ABORT("Unsupported dimension"); }
+}
+
+KernelCost ForcePAOperator::MultCost() const
+{
+   const int nH1dof1D = tensors1D->HQshape1D.Height(),
+             nL2dof1D = tensors1D->LQshape1D.Height(),
+             nqp1D    = tensors1D->HQshape1D.Width();
+   const double nH1dof = pow(nH1dof1D, dim), nL2dof = pow(nL2dof1D, dim),
+                nqp = pow(nqp1D, dim);
+   // Energy at the quadrature points, then, for each of the dim x dim stress
+   // components, scaling and the gradient contraction back to the H1 dofs.
+   const double flops = ContractFlops(dim, nL2dof1D, nqp1D) +
+                        dim * dim * (nqp + ContractFlops(dim, nqp1D, nH1dof1D)
+                                     + nH1dof);
+   // L2 values and indices, stress, H1 read-modify-write and indices.
+   const double bytes = (sizeof(double) + sizeof(int)) * nL2dof +
+                        quad_data->StressBytes() * dim * dim * nqp +
+                        (2 * sizeof(double) + sizeof(int)) * dim * nH1dof;
+   return KernelCost(nzones * flops, nzones * bytes +
+                     sizeof(double) * H1FESpace.GetVSize());
+}
+
+KernelCost ForcePAOperator::MultTransposeCost() const
+{
+   const int nH1dof1D = tensors1D->HQshape1D.Height(),
+             nL2dof1D = tensors1D->LQshape1D.Height(),
+             nqp1D    = tensors1D->HQshape1D.Width();
+   const double nH1dof = pow(nH1dof1D, dim), nL2dof = pow(nL2dof1D, dim),
+                nqp = pow(nqp1D, dim);
+   // Velocity gradients, stress:grad_v, then the contraction to the L2 dofs.
+   const double flops = dim * dim * (ContractFlops(dim, nH1dof1D, nqp1D) +
+                                     2 * nqp) +
+                        ContractFlops(dim, nqp1D, nL2dof1D);
+   const double bytes = (sizeof(double) + sizeof(int)) * dim * nH1dof +
+                        quad_data->StressBytes() * dim * dim * nqp +
+                        (sizeof(double) + sizeof(int)) * nL2dof;
+   return KernelCost(nzones * flops, nzones * bytes);
+}
+
 // Force matrix action on quadrilateral elements in 2D.
-void ForcePAOperator::MultQuad(const Vector &vecL2, Vector &vecH1) const
+void ForcePAOperator::MultQuad(const QuadratureData &qdata, int z_first,
+                               int nz, const Vector &vecL2,
+                               Vector &vecH1) const
 {
    const int nH1dof1D = tensors1D->HQshape1D.Height(),
              nL2dof1D = tensors1D->LQshape1D.Height(),
@@ -381,8 +677,7 @@ void ForcePAOperator::MultQuad(const Vector &vecL2, Vector &vecH1) const
       dynamic_cast<const H1_QuadrilateralElement *>(H1FESpace.GetFE(0));
    const Array<int> &dof_map = fe->GetDofMap();
 
-   vecH1 = 0.0;
-   for (int z = 0; z < nzones; z++)
+   for (int z = z_first; z < z_first + nz; z++)
    {
       // Note that the local numbering for L2 is the tensor numbering.
       L2FESpace.GetElementDofs(z, l2dofs);
@@ -399,16 +694,14 @@ void ForcePAOperator::MultQuad(const Vector &vecL2, Vector &vecH1) const
          // QQd_k1_k2 *= stress_k1_k2(c,0)  -- stress that scales d[v_c]_dx.
          // HQ_i2_k1   = HQs_i2_k2 QQ_k1_k2 -- contract in y direction.
          // HHx_i1_i2  = HQg_i1_k1 HQ_i2_k1 -- gradients in x direction.
-         double *d = quad_data->stressJinvT(c).GetData() + z*nqp;
-         for (int q = 0; q < nqp; q++) { data_qd[q] = data_q[q] * d[q]; };
+         qdata.ScaleByStress(c, 0, z - z_first, nqp, data_q, data_qd);
          MultABt(tensors1D->HQshape1D, QQd, HQ);
          MultABt(tensors1D->HQgrad1D, HQ, HHx);
 
          // QQd_k1_k2 *= stress_k1_k2(c,1) -- stress that scales d[v_c]_dy.
          // HQ_i2_k1  = HQg_i2_k2 QQ_k1_k2 -- gradients in y direction.
          // HHy_i1_i2 = HQ_i1_k1 HQ_i2_k1  -- contract in x direction.
-         d = quad_data->stressJinvT(c).GetData() + 1*nzones*nqp + z*nqp;
-         for (int q = 0; q < nqp; q++) { data_qd[q] = data_q[q] * d[q]; };
+         qdata.ScaleByStress(c, 1, z - z_first, nqp, data_q, data_qd);
          MultABt(tensors1D->HQgrad1D, QQd, HQ);
          MultABt(tensors1D->HQshape1D, HQ, HHy);
 
@@ -430,7 +723,9 @@ void ForcePAOperator::MultQuad(const Vector &vecL2, Vector &vecH1) const
 }
 
 // Force matrix action on hexahedral elements in 3D.
-void ForcePAOperator::MultHex(const Vector &vecL2, Vector &vecH1) const
+void ForcePAOperator::MultHex(const QuadratureData &qdata, int z_first,
+                              int nz, const Vector &vecL2,
+                              Vector &vecH1) const
 {
    const int nH1dof1D = tensors1D->HQshape1D.Height(),
              nL2dof1D = tensors1D->LQshape1D.Height(),
@@ -458,8 +753,7 @@ void ForcePAOperator::MultHex(const Vector &vecL2, Vector &vecH1) const
       dynamic_cast<const H1_HexahedronElement *>(H1FESpace.GetFE(0));
    const Array<int> &dof_map = fe->GetDofMap();
 
-   vecH1 = 0.0;
-   for (int z = 0; z < nzones; z++)
+   for (int z = z_first; z < z_first + nz; z++)
    {
       // Note that the local numbering for L2 is the tensor numbering.
       L2FESpace.GetElementDofs(z, l2dofs);
@@ -491,8 +785,7 @@ void ForcePAOperator::MultHex(const Vector &vecL2, Vector &vecH1) const
       for (int c = 0; c < 3; c++)
       {
          // QQQc_k1_k2_k3 *= stress_k1_k2_k3(c,0) -- stress scaling d[v_c]_dx.
-         double *d = quad_data->stressJinvT(c).GetData() + z*nqp;
-         for (int q = 0; q < nqp; q++) { qqqc[q] = qqq[q] * d[q]; };
+         qdata.ScaleByStress(c, 0, z - z_first, nqp, qqq, qqqc);
 
          // QHQ_k1_i2_k3  = QQQc_k1_k2_k3 HQs_i2_k2 -- contract  in y direction.
          // The first step does some reordering (it's not product of matrices).
@@ -517,8 +810,7 @@ void ForcePAOperator::MultHex(const Vector &vecL2, Vector &vecH1) const
          MultABt(HH_Q, tensors1D->HQshape1D, HHHx);
 
          // QQQc_k1_k2_k3 *= stress_k1_k2_k3(c,1) -- stress scaling d[v_c]_dy.
-         d = quad_data->stressJinvT(c).GetData() + 1*nzones*nqp + z*nqp;
-         for (int q = 0; q < nqp; q++) { qqqc[q] = qqq[q] * d[q]; };
+         qdata.ScaleByStress(c, 1, z - z_first, nqp, qqq, qqqc);
 
          // QHQ_k1_i2_k3  = QQQc_k1_k2_k3 HQg_i2_k2 -- gradients in y direction.
          // The first step does some reordering (it's not product of matrices).
@@ -543,8 +835,7 @@ void ForcePAOperator::MultHex(const Vector &vecL2, Vector &vecH1) const
          MultABt(HH_Q, tensors1D->HQshape1D, HHHy);
 
          // QQQc_k1_k2_k3 *= stress_k1_k2_k3(c,2) -- stress scaling d[v_c]_dz.
-         d = quad_data->stressJinvT(c).GetData() + 2*nzones*nqp + z*nqp;
-         for (int q = 0; q < nqp; q++) { qqqc[q] = qqq[q] * d[q]; };
+         qdata.ScaleByStress(c, 2, z - z_first, nqp, qqq, qqqc);
 
          // QHQ_k1_i2_k3  = QQQc_k1_k2_k3 HQg_i2_k2 -- contract  in y direction.
          // The first step does some reordering (it's not product of matrices).
@@ -591,7 +882,9 @@ void ForcePAOperator::MultHex(const Vector &vecL2, Vector &vecH1) const
 }
 
 // Transpose force matrix action on quadrilateral elements in 2D.
-void ForcePAOperator::MultTransposeQuad(const Vector &vecH1,
+void ForcePAOperator::MultTransposeQuad(const QuadratureData &qdata,
+                                        int z_first, int nz,
+                                        const Vector &vecH1,
                                         Vector &vecL2) const
 {
    const int nH1dof1D = tensors1D->HQshape1D.Height(),
@@ -610,7 +903,7 @@ void ForcePAOperator::MultTransposeQuad(const Vector &vecH1,
       dynamic_cast<const H1_QuadrilateralElement *>(H1FESpace.GetFE(0));
    const Array<int> &dof_map = fe->GetDofMap();
 
-   for (int z = 0; z < nzones; z++)
+   for (int z = z_first; z < z_first + nz; z++)
    {
       H1FESpace.GetElementVDofs(z, h1dofs);
 
@@ -632,8 +925,7 @@ void ForcePAOperator::MultTransposeQuad(const Vector &vecH1,
          // QQc_k1_k2 *= stress_k1_k2(c,0)  -- stress that scales d[v_c]_dx.
          MultAtB(V, tensors1D->HQgrad1D, HQ);
          MultAtB(HQ, tensors1D->HQshape1D, QQc);
-         double *d = quad_data->stressJinvT(c).GetData() + z*nqp;
-         for (int q = 0; q < nqp; q++) { qqc[q] *= d[q]; }
+         qdata.ScaleByStress(c, 0, z - z_first, nqp, qqc, qqc);
          // Add the (stress(c,0) * d[v_c]_dx) part of (stress:grad_v).
          QQ += QQc;
 
@@ -642,8 +934,7 @@ void ForcePAOperator::MultTransposeQuad(const Vector &vecH1,
          // QQc_k1_k2 *= stress_k1_k2(c,1)  -- stress that scales d[v_c]_dy.
          MultAtB(V, tensors1D->HQshape1D, HQ);
          MultAtB(HQ, tensors1D->HQgrad1D, QQc);
-         d = quad_data->stressJinvT(c).GetData() + 1*nzones*nqp + z*nqp;
-         for (int q = 0; q < nqp; q++) { qqc[q] *= d[q]; }
+         qdata.ScaleByStress(c, 1, z - z_first, nqp, qqc, qqc);
          // Add the (stress(c,1) * d[v_c]_dy) part of (stress:grad_v).
          QQ += QQc;
       }
@@ -659,7 +950,10 @@ void ForcePAOperator::MultTransposeQuad(const Vector &vecH1,
 }
 
 // Transpose force matrix action on hexahedral elements in 3D.
-void ForcePAOperator::MultTransposeHex(const Vector &vecH1, Vector &vecL2) const
+void ForcePAOperator::MultTransposeHex(const QuadratureData &qdata,
+                                       int z_first, int nz,
+                                       const Vector &vecH1,
+                                       Vector &vecL2) const
 {
    const int nH1dof1D = tensors1D->HQshape1D.Height(),
              nL2dof1D = tensors1D->LQshape1D.Height(),
@@ -684,7 +978,7 @@ void ForcePAOperator::MultTransposeHex(const Vector &vecH1, Vector &vecL2) const
       dynamic_cast<const H1_HexahedronElement *>(H1FESpace.GetFE(0));
    const Array<int> &dof_map = fe->GetDofMap();
 
-   for (int z = 0; z < nzones; z++)
+   for (int z = z_first; z < z_first + nz; z++)
    {
       H1FESpace.GetElementVDofs(z, h1dofs);
 
@@ -723,8 +1017,7 @@ void ForcePAOperator::MultTransposeHex(const Vector &vecH1, Vector &vecL2) const
             }
          }
          // QQQc_k1_k2_k3 *= stress_k1_k2_k3(c,0) -- stress scaling d[v_c]_dx.
-         double *d = quad_data->stressJinvT(c).GetData() + z*nqp;
-         for (int q = 0; q < nqp; q++) { qqqc[q] *= d[q]; };
+         qdata.ScaleByStress(c, 0, z - z_first, nqp, qqqc, qqqc);
          // Add the (stress(c,0) * d[v_c]_dx) part of (stress:grad_v).
          QQ_Q += QQ_Qc;
 
@@ -750,8 +1043,7 @@ void ForcePAOperator::MultTransposeHex(const Vector &vecH1, Vector &vecL2) const
             }
          }
          // QQQc_k1_k2_k3 *= stress_k1_k2_k3(c,1) -- stress scaling d[v_c]_dy.
-         d = quad_data->stressJinvT(c).GetData() + 1*nzones*nqp + z*nqp;
-         for (int q = 0; q < nqp; q++) { qqqc[q] *= d[q]; };
+         qdata.ScaleByStress(c, 1, z - z_first, nqp, qqqc, qqqc);
          // Add the (stress(c,1) * d[v_c]_dy) part of (stress:grad_v).
          QQ_Q += QQ_Qc;
 
@@ -777,8 +1069,7 @@ void ForcePAOperator::MultTransposeHex(const Vector &vecH1, Vector &vecL2) const
             }
          }
          // QQQc_k1_k2_k3 *= stress_k1_k2_k3(c,2) -- stress scaling d[v_c]_dz.
-         d = quad_data->stressJinvT(c).GetData() + 2*nzones*nqp + z*nqp;
-         for (int q = 0; q < nqp; q++) { qqqc[q] *= d[q]; };
+         qdata.ScaleByStress(c, 2, z - z_first, nqp, qqqc, qqqc);
          // Add the (stress(c,2) * d[v_c]_dz) part of (stress:grad_v).
          QQ_Q += QQ_Qc;
       }
@@ -823,6 +1114,20 @@ void MassPAOperator::Mult(const Vector &x, Vector &y) const
    }
 }
 
+KernelCost MassPAOperator::MultCost() const
+{
+   const int ndof1D = tensors1D->HQshape1D.Height(),
+             nqp1D  = tensors1D->HQshape1D.Width();
+   const double ndof = pow(ndof1D, dim), nqp = pow(nqp1D, dim);
+   // Each of the dim components is a scalar mass action.
+   const double flops = ContractFlops(dim, ndof1D, nqp1D) + nqp +
+                        ContractFlops(dim, nqp1D, ndof1D);
+   const double bytes = (3 * sizeof(double) + sizeof(int)) * ndof +
+                        quad_data->ValueBytes() * nqp;
+   return KernelCost(dim * nzones * flops, dim * nzones * bytes +
+                     sizeof(double) * FESpace.GetVSize());
+}
+
 // Mass matrix action on quadrilateral elements in 2D.
 void MassPAOperator::MultQuad(const Vector &x, Vector &y) const
 {
@@ -859,8 +1164,7 @@ void MassPAOperator::MultQuad(const Vector &x, Vector &y) const
       MultAtB(HQs, HQ, QQ);
 
       // QQ_k1_k2 *= quad_data_k1_k2 -- scaling with quadrature values.
-      double *d = quad_data->rho0DetJ0w.GetData() + z*nqp;
-      for (int q = 0; q < nqp; q++) { qq[q] *= d[q]; }
+      quad_data->ScaleByMass(z, nqp, qq, qq);
 
       // HQ_i1_k2 = HQs_i1_k1 QQ_k1_k2 -- contract in x direction.
       // Y_i1_i2  = HQ_i1_k2 HQs_i2_k2 -- contract in y direction.
@@ -930,8 +1234,7 @@ void MassPAOperator::MultHex(const Vector &x, Vector &y) const
       }
 
       // QQQ_k1_k2_k3 *= quad_data_k1_k2_k3 -- scaling with quadrature values.
-      double *d = quad_data->rho0DetJ0w.GetData() + z*nqp;
-      for (int q = 0; q < nqp; q++) { qqq[q] *= d[q]; }
+      quad_data->ScaleByMass(z, nqp, qqq, qqq);
 
       // QHQ_k1_i2_k3 = QQQ_k1_k2_k3 HQs_i2_k2 -- contract in y direction.
       // The first step does some reordering (it's not product of matrices).
@@ -969,6 +1272,17 @@ void LocalMassPAOperator::Mult(const Vector &x, Vector &y) const
    else { MFEM_ABORT("Unsupported dimension"); }
 }
 
+KernelCost LocalMassPAOperator::MultCost() const
+{
+   const int ndof1D = tensors1D->LQshape1D.Height(),
+             nqp1D  = tensors1D->LQshape1D.Width();
+   const double ndof = pow(ndof1D, dim), nqp = pow(nqp1D, dim);
+   const double flops = ContractFlops(dim, ndof1D, nqp1D) + nqp +
+                        ContractFlops(dim, nqp1D, ndof1D);
+   return KernelCost(flops, sizeof(double) * 2 * ndof +
+                     quad_data->ValueBytes() * nqp);
+}
+
 // L2 mass matrix action on a single quadrilateral element in 2D.
 void LocalMassPAOperator::MultQuad(const Vector &x, Vector &y) const
 {
@@ -989,8 +1303,7 @@ void LocalMassPAOperator::MultQuad(const Vector &x, Vector &y) const
    MultAtB(LQs, LQ, QQ);
 
    // QQ_k1_k2 *= quad_data_k1_k2 -- scaling with quadrature values.
-   const double *d = quad_data->rho0DetJ0w.GetData() + zone_id*nqp;
-   for (int q = 0; q < nqp; q++) { qq[q] *= d[q]; }
+   quad_data->ScaleByMass(zone_id, nqp, qq, qq);
 
    // LQ_i1_k2 = LQs_i1_k1 QQ_k1_k2 -- contract in x direction.
    // Y_i1_i2  = LQ_i1_k2 LQs_i2_k2 -- contract in y direction.
@@ -1039,8 +1352,7 @@ void LocalMassPAOperator::MultHex(const Vector &x, Vector &y) const
    }
 
    // QQQ_k1_k2_k3 *= quad_data_k1_k2_k3 -- scaling with quadrature values.
-   double *d = quad_data->rho0DetJ0w.GetData() + zone_id*nqp;
-   for (int q = 0; q < nqp; q++) { qqq[q] *= d[q]; }
+   quad_data->ScaleByMass(zone_id, nqp, qqq, qqq);
 
    // QLQ_k1_i2_k3 = QQQ_k1_k2_k3 LQs_i2_k2 -- contract in y direction.
    // The first step does some reordering (it's not product of matrices).
@@ -1068,5 +1380,3 @@ void LocalMassPAOperator::MultHex(const Vector &x, Vector &y) const
 } // namespace hydrodynamics
 
 } // namespace mfem
-
-#endif // MFEM_USE_MPI
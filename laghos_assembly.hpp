@@ -17,13 +17,11 @@
 #ifndef MFEM_LAGHOS_ASSEMBLY
 #define MFEM_LAGHOS_ASSEMBLY
 
-#include "mfem.hpp"
-
-
-#ifdef MFEM_USE_MPI
+#include "laghos_compat.hpp"
 
 #include <memory>
 #include <iostream>
+#include <vector>
 
 namespace mfem
 {
@@ -61,38 +59,126 @@ struct QuadratureData
    // recomputed at every time step to achieve adaptive time stepping.
    double dt_est;
 
-   QuadratureData(int dim, int nzones, int quads_per_zone)
+   // Total internal energy of the zones, the sum of rho0DetJ0w * e over the
+   // quadrature points, computed with the rest of the quadrature data.
+   double internal_energy;
+
+   // Smallest determinant of the reference->physical Jacobians at the
+   // quadrature points, computed with the rest of the quadrature data.
+   double min_detJ;
+
+   // Single precision copies of stressJinvT and rho0DetJ0w, with the same
+   // layout, used by the partial assembly kernels after SetFloat(). This
+   // halves the kernels' quadrature data traffic; their arithmetic stays in
+   // double. The double stressJinvT is then freed.
+   bool use_float;
+   std::vector<float> stressJinvT_f, rho0DetJ0w_f;
+
+   // Whether the stress is stored, in stressJinvT or stressJinvT_f.
+   const bool store_stress;
+
+   // Without store_stress, stressJinvT is left empty; the force operator then
+   // computes it a few zones at a time, see LagrangianHydroOperator.
+   QuadratureData(int dim, int nzones, int quads_per_zone,
+                  bool store_stress_ = true)
       : Jac0inv(dim, dim, nzones * quads_per_zone),
-        stressJinvT(nzones * quads_per_zone, dim, dim),
-        rho0DetJ0w(nzones * quads_per_zone) { }
+        stressJinvT(store_stress_ ? nzones * quads_per_zone : 0, dim, dim),
+        rho0DetJ0w(nzones * quads_per_zone), use_float(false),
+        store_stress(store_stress_) { }
+
+   // Switches the partial assembly data to single precision, starting from
+   // the current double values.
+   void SetFloat();
+
+   // Size of one value of the partial assembly data.
+   int ValueBytes() const
+   { return use_float ? (int) sizeof(float) : (int) sizeof(double); }
+
+   // Size of one stored stress value, 0 when the stress isn't stored.
+   int StressBytes() const
+   { return store_stress ? ValueBytes() : 0; }
+
+   // Sets the (vd, gd) entry of stressJinvT at point idx.
+   void SetStress(int vd, int gd, int idx, double value)
+   {
+      if (use_float)
+      {
+         const int dim = Jac0inv.SizeI(), n = rho0DetJ0w.Size();
+         stressJinvT_f[(vd*dim + gd)*n + idx] = (float) value;
+      }
+      else { stressJinvT(vd)(idx, gd) = value; }
+   }
+
+   // y = x * d at the nqp points of zone z, where d is the (vd, gd) entry of
+   // stressJinvT, or rho0DetJ0w. x and y may be the same.
+   void ScaleByStress(int vd, int gd, int z, int nqp,
+                      const double *x, double *y) const;
+   void ScaleByMass(int z, int nqp, const double *x, double *y) const;
+};
+
+// Analytic cost of one application of a partial assembly kernel. The flops
+// follow the sizes of the sum factorization contractions, with a multiply-add
+// counted as two operations. The bytes are the compulsory memory traffic:
+// input and output vectors, quadrature data and dof indices, assuming the 1D
+// tensors and the zone temporaries stay in cache.
+struct KernelCost
+{
+   double flops, bytes;
+
+   KernelCost() : flops(0.0), bytes(0.0) { }
+   KernelCost(double f, double b) : flops(f), bytes(b) { }
+
+   KernelCost &operator+=(const KernelCost &c)
+   { flops += c.flops; bytes += c.bytes; return *this; }
+   KernelCost &operator*=(double s)
+   { flops *= s; bytes *= s; return *this; }
 };
 
 // Stores values of the one-dimensional shape functions and gradients at all 1D
-// quadrature points. All sizes are (dofs1D_cnt x quads1D_cnt).
+// quadrature points. All sizes are (dofs1D_cnt x quads1D_cnt). The tables are
+// owned by the hydro operator and passed to its partial assembly operators, so
+// several operators of different orders can live in one process.
 struct Tensors1D
 {
    // H1 shape functions and gradients, L2 shape functions.
    DenseMatrix HQshape1D, HQgrad1D, LQshape1D;
 
    Tensors1D(int H1order, int L2order, int nqp1D);
+
+   // Number of 1D points of a tensor product rule with nqp points.
+   static int NumQuad1D(int nqp, int dim)
+   { return int(floor(0.7 + pow(nqp, 1.0 / dim))); }
 };
-extern const Tensors1D *tensors1D;
 
 class FastEvaluator
 {
    const int dim;
    ParFiniteElementSpace &H1FESpace;
+   const Tensors1D *tensors1D;
 
 public:
-   FastEvaluator(ParFiniteElementSpace &h1fes)
-      : dim(h1fes.GetMesh()->Dimension()), H1FESpace(h1fes) { }
+   FastEvaluator(ParFiniteElementSpace &h1fes, const Tensors1D *tensors)
+      : dim(h1fes.GetMesh()->Dimension()), H1FESpace(h1fes),
+        tensors1D(tensors) { }
 
    void GetL2Values(const Vector &vecL2, Vector &vecQP) const;
    // The input vec is an H1 function with dim components, over a zone.
    // The output is J_ij = d(vec_i) / d(x_j) with ij = 1 .. dim.
    void GetVectorGrad(const DenseMatrix &vec, DenseTensor &J) const;
+   // All of the above in one pass over a zone: the L2 values of vecL2 and the
+   // gradients J[f] of the nvec H1 vector fields vec[f], e.g., the positions
+   // and the velocity. The contractions of all field components share single
+   // matrix products with the 1D tables. When vals is given, it also gets the
+   // values of the first field, vals(q, i) = vec[0]_i.
+   void GetZoneValues(const Vector &vecL2, Vector &vecQ, int nvec,
+                      const DenseMatrix *vec, DenseTensor *J,
+                      DenseMatrix *vals = NULL) const;
+
+   // Costs of the above evaluations for a single zone.
+   KernelCost GetL2ValuesCost() const;
+   KernelCost GetZoneValuesCost(int nvec, bool values) const;
+   KernelCost GetVectorGradCost() const;
 };
-extern const FastEvaluator *evaluator;
 
 // This class is used only for visualization. It assembles (rho, phi) in each
 // zone, which is used by LagrangianHydroOperator::ComputeDensity to do an L2
@@ -134,27 +220,44 @@ private:
    const int dim, nzones;
 
    QuadratureData *quad_data;
+   const Tensors1D *tensors1D;
    ParFiniteElementSpace &H1FESpace, &L2FESpace;
 
    // Force matrix action on quadrilateral elements in 2D.
-   void MultQuad(const Vector &vecL2, Vector &vecH1) const;
+   void MultQuad(const QuadratureData &qdata, int z_first, int nz,
+                 const Vector &vecL2, Vector &vecH1) const;
    // Force matrix action on hexahedral elements in 3D.
-   void MultHex(const Vector &vecL2, Vector &vecH1) const;
+   void MultHex(const QuadratureData &qdata, int z_first, int nz,
+                const Vector &vecL2, Vector &vecH1) const;
 
    // Transpose force matrix action on quadrilateral elements in 2D.
-   void MultTransposeQuad(const Vector &vecH1, Vector &vecL2) const;
+   void MultTransposeQuad(const QuadratureData &qdata, int z_first, int nz,
+                          const Vector &vecH1, Vector &vecL2) const;
    // Transpose force matrix action on hexahedral elements in 3D.
-   void MultTransposeHex(const Vector &vecH1, Vector &vecL2) const;
+   void MultTransposeHex(const QuadratureData &qdata, int z_first, int nz,
+                         const Vector &vecH1, Vector &vecL2) const;
 
 public:
-   ForcePAOperator(QuadratureData *quad_data_,
+   ForcePAOperator(QuadratureData *quad_data_, const Tensors1D *tensors,
                    ParFiniteElementSpace &h1fes, ParFiniteElementSpace &l2fes)
       : dim(h1fes.GetMesh()->Dimension()), nzones(h1fes.GetMesh()->GetNE()),
-        quad_data(quad_data_), H1FESpace(h1fes), L2FESpace(l2fes) { }
+        quad_data(quad_data_), tensors1D(tensors),
+        H1FESpace(h1fes), L2FESpace(l2fes) { }
 
    virtual void Mult(const Vector &vecL2, Vector &vecH1) const;
    virtual void MultTranspose(const Vector &vecH1, Vector &vecL2) const;
 
+   // The actions restricted to the nz zones starting at z_first, with the
+   // stress of zone z_first + z taken from zone z of zone_data. AddMultZones
+   // adds to vecH1, MultTransposeZones sets the dofs of the zones in vecL2.
+   void AddMultZones(const QuadratureData &zone_data, int z_first, int nz,
+                     const Vector &vecL2, Vector &vecH1) const;
+   void MultTransposeZones(const QuadratureData &zone_data, int z_first,
+                           int nz, const Vector &vecH1, Vector &vecL2) const;
+
+   KernelCost MultCost() const;
+   KernelCost MultTransposeCost() const;
+
    ~ForcePAOperator() { }
 };
 
@@ -165,6 +268,7 @@ private:
    const int dim, nzones;
 
    QuadratureData *quad_data;
+   const Tensors1D *tensors1D;
    ParFiniteElementSpace &FESpace;
 
    // Mass matrix action on quadrilateral elements in 2D.
@@ -173,14 +277,16 @@ private:
    void MultHex(const Vector &x, Vector &y) const;
 
 public:
-   MassPAOperator(QuadratureData *quad_data_, ParFiniteElementSpace &fes)
+   MassPAOperator(QuadratureData *quad_data_, const Tensors1D *tensors,
+                  ParFiniteElementSpace &fes)
       : Operator(fes.GetVSize()),
         dim(fes.GetMesh()->Dimension()), nzones(fes.GetMesh()->GetNE()),
-        quad_data(quad_data_), FESpace(fes)
+        quad_data(quad_data_), tensors1D(tensors), FESpace(fes)
    { }
 
    // Mass matrix action.
    virtual void Mult(const Vector &x, Vector &y) const;
+   KernelCost MultCost() const;
 
    virtual const Operator *GetProlongation() const
    { return FESpace.GetProlongationMatrix(); }
@@ -197,6 +303,7 @@ private:
    int zone_id;
 
    QuadratureData *quad_data;
+   const Tensors1D *tensors1D;
 
    // Mass matrix action on a quadrilateral element in 2D.
    void MultQuad(const Vector &x, Vector &y) const;
@@ -204,20 +311,21 @@ private:
    void MultHex(const Vector &x, Vector &y) const;
 
 public:
-   LocalMassPAOperator(QuadratureData *quad_data_, ParFiniteElementSpace &fes)
+   LocalMassPAOperator(QuadratureData *quad_data_, const Tensors1D *tensors,
+                       ParFiniteElementSpace &fes)
       : Operator(fes.GetFE(0)->GetDof()),
         dim(fes.GetMesh()->Dimension()), zone_id(0),
-        quad_data(quad_data_)
+        quad_data(quad_data_), tensors1D(tensors)
    { }
    void SetZoneId(int zid) { zone_id = zid; }
 
    virtual void Mult(const Vector &x, Vector &y) const;
+   // Cost of the action on one zone.
+   KernelCost MultCost() const;
 };
 
 } // namespace hydrodynamics
 
 } // namespace mfem
 
-#endif // MFEM_USE_MPI
-
 #endif // MFEM_LAGHOS_ASSEMBLY
@@ -0,0 +1,297 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+//
+//                   Laghos partial assembly kernel benchmark
+//
+// Times the partial assembly kernels of Laghos in isolation, outside of the
+// time stepping loop: the force operator and its transpose, the velocity mass
+// operator, the zone-local energy mass operator and the quadrature point
+// evaluations of FastEvaluator, separate and fused. The quadrature data is
+// built on a Cartesian mesh from its Jacobians, with a unit pressure as the
+// stress, and the kernels are applied to random vectors.
+//
+// The rates use the analytic flop and byte counts of the kernels (see
+// KernelCost in laghos_assembly.hpp), the maximum time over the MPI tasks and
+// the dofs each kernel reads.
+//
+// Sample runs:
+//    mpirun -np 4 laghos_bench -dim 2 -z 64 -ok 2 -ot 1 -n 20
+//    mpirun -np 8 laghos_bench -dim 3 -z 16 -ok 3 -ot 2 -n 10
+
+#include "laghos_assembly.hpp"
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+using namespace mfem;
+using namespace mfem::hydrodynamics;
+
+// Fills the quadrature data from the Jacobians of the mesh, for unit density
+// and unit pressure.
+static void SetQuadratureData(ParFiniteElementSpace &h1_fes,
+                              const IntegrationRule &ir,
+                              QuadratureData &quad_data);
+
+// Prints one line of the benchmark table; the cost is the one of a single
+// application, the dofs are the ones read by a single application.
+static void PrintRates(const char *name, int reps, double time,
+                       const KernelCost &cost, double dofs);
+
+int main(int argc, char *argv[])
+{
+   // Initialize MPI.
+   MPI_Session mpi(argc, argv);
+
+   // Parse command-line options.
+   int dim = 2;
+   int zones = 32;
+   int order_v = 2;
+   int order_e = 1;
+   int reps = 10;
+   bool quad_float = false;
+
+   OptionsParser args(argc, argv);
+   args.AddOption(&dim, "-dim", "--dimension", "Mesh dimension (2 or 3).");
+   args.AddOption(&zones, "-z", "--zones",
+                  "Number of zones in each direction of the global mesh.");
+   args.AddOption(&order_v, "-ok", "--order-kinematic",
+                  "Order (degree) of the kinematic finite element space.");
+   args.AddOption(&order_e, "-ot", "--order-thermo",
+                  "Order (degree) of the thermodynamic finite element space.");
+   args.AddOption(&reps, "-n", "--repetitions",
+                  "Number of timed applications of each kernel.");
+   args.AddOption(&quad_float, "-qf", "--quad-float", "-no-qf",
+                  "--no-quad-float",
+                  "Store the quadrature data in single precision.");
+   args.Parse();
+   if (!args.Good() || (dim != 2 && dim != 3) || zones < 1 || reps < 1)
+   {
+      if (mpi.Root()) { args.PrintUsage(cout); }
+      return 1;
+   }
+   if (mpi.Root()) { args.PrintOptions(cout); }
+
+   Mesh *mesh = (dim == 2) ?
+                new Mesh(zones, zones, Element::QUADRILATERAL, true) :
+                new Mesh(zones, zones, zones, Element::HEXAHEDRON, true);
+   if (mpi.WorldSize() > mesh->GetNE())
+   {
+      if (mpi.Root())
+      {
+         cout << "The mesh has fewer zones than MPI tasks, increase -z."
+              << endl;
+      }
+      delete mesh;
+      return 2;
+   }
+   ParMesh *pmesh = new ParMesh(MPI_COMM_WORLD, *mesh);
+   delete mesh;
+
+   L2_FECollection L2FEC(order_e, dim, BasisType::Positive);
+   H1_FECollection H1FEC(order_v, dim);
+   ParFiniteElementSpace L2FESpace(pmesh, &L2FEC);
+   ParFiniteElementSpace H1FESpace(pmesh, &H1FEC, dim);
+
+   // The same quadrature as in LagrangianHydroOperator.
+   const IntegrationRule &ir =
+      IntRules.Get(pmesh->GetElementBaseGeometry(),
+                   3*H1FESpace.GetOrder(0) + L2FESpace.GetOrder(0) - 1);
+   const int nzones = pmesh->GetNE(), nqp = ir.GetNPoints();
+   QuadratureData quad_data(dim, nzones, nqp);
+   SetQuadratureData(H1FESpace, ir, quad_data);
+   quad_data.h0 = 1.0 / zones / order_v;
+   if (quad_float) { quad_data.SetFloat(); }
+
+   const Tensors1D tensors1D(order_v, order_e,
+                             Tensors1D::NumQuad1D(nqp, dim));
+   const FastEvaluator evaluator(H1FESpace, &tensors1D);
+
+   ForcePAOperator ForcePA(&quad_data, &tensors1D, H1FESpace, L2FESpace);
+   MassPAOperator VMassPA(&quad_data, &tensors1D, H1FESpace);
+   LocalMassPAOperator locEMassPA(&quad_data, &tensors1D, L2FESpace);
+
+   const int h1_vsize = H1FESpace.GetVSize(), l2_vsize = L2FESpace.GetVSize();
+   const int l2dofs_cnt = L2FESpace.GetFE(0)->GetDof(),
+             h1dofs_cnt = H1FESpace.GetFE(0)->GetDof();
+   Vector vecH1(h1_vsize), vecL2(l2_vsize), outH1(h1_vsize), outL2(l2_vsize);
+   vecH1.Randomize(1 + mpi.WorldRank());
+   vecL2.Randomize(1 + mpi.WorldRank());
+
+   // Zone-local input of the per-zone kernels, gathered before the timing.
+   Vector e_zones(nzones * l2dofs_cnt), v_zones(nzones * h1dofs_cnt * dim);
+   {
+      Array<int> dofs;
+      Vector loc;
+      for (int z = 0; z < nzones; z++)
+      {
+         L2FESpace.GetElementDofs(z, dofs);
+         loc.SetDataAndSize(e_zones.GetData() + z*l2dofs_cnt, l2dofs_cnt);
+         vecL2.GetSubVector(dofs, loc);
+         H1FESpace.GetElementVDofs(z, dofs);
+         loc.SetDataAndSize(v_zones.GetData() + z*h1dofs_cnt*dim,
+                            h1dofs_cnt*dim);
+         vecH1.GetSubVector(dofs, loc);
+      }
+   }
+   Vector e_loc, de_loc(l2dofs_cnt), e_vals;
+   DenseMatrix v_loc, xv_loc[2];
+   DenseTensor grad_v(dim, dim, nqp), grads[2];
+
+   // The fused evaluation is timed as in UpdateQuadratureData: the energy
+   // values and the gradients of two vector fields (here twice the same).
+   const int num_kernels = 7;
+   const char *names[num_kernels] =
+   {
+      "Force", "Force transpose", "Velocity mass", "Energy mass (zone)",
+      "L2 values (zone)", "Vector gradient (zone)", "Fused values (zone)"
+   };
+   KernelCost cost[num_kernels];
+   double dofs[num_kernels], time[num_kernels];
+   cost[0] = ForcePA.MultCost();
+   cost[1] = ForcePA.MultTransposeCost();
+   cost[2] = VMassPA.MultCost();
+   cost[3] = locEMassPA.MultCost();
+   cost[4] = evaluator.GetL2ValuesCost();
+   cost[5] = evaluator.GetVectorGradCost();
+   cost[6] = evaluator.GetZoneValuesCost(2, false);
+   for (int k = 3; k < num_kernels; k++) { cost[k] *= nzones; }
+   dofs[0] = l2_vsize; dofs[1] = h1_vsize; dofs[2] = h1_vsize;
+   dofs[3] = l2_vsize; dofs[4] = l2_vsize; dofs[5] = h1_vsize;
+   dofs[6] = l2_vsize + 2 * h1_vsize;
+
+   StopWatch sw;
+   for (int k = 0; k < num_kernels; k++)
+   {
+      // The first application is a warm-up and isn't timed.
+      for (int r = -1; r < reps; r++)
+      {
+         if (r == 0)
+         {
+            MPI_Barrier(pmesh->GetComm());
+            sw.Clear();
+            sw.Start();
+         }
+         switch (k)
+         {
+            case 0: ForcePA.Mult(vecL2, outH1); break;
+            case 1: ForcePA.MultTranspose(vecH1, outL2); break;
+            case 2: VMassPA.Mult(vecH1, outH1); break;
+            default:
+               for (int z = 0; z < nzones; z++)
+               {
+                  e_loc.SetDataAndSize(e_zones.GetData() + z*l2dofs_cnt,
+                                       l2dofs_cnt);
+                  v_loc.UseExternalData(v_zones.GetData() + z*h1dofs_cnt*dim,
+                                        h1dofs_cnt, dim);
+                  if (k == 3)
+                  {
+                     locEMassPA.SetZoneId(z);
+                     locEMassPA.Mult(e_loc, de_loc);
+                  }
+                  else if (k == 4) { evaluator.GetL2Values(e_loc, e_vals); }
+                  else if (k == 5) { evaluator.GetVectorGrad(v_loc, grad_v); }
+                  else
+                  {
+                     xv_loc[0].UseExternalData(v_loc.Data(), h1dofs_cnt, dim);
+                     xv_loc[1].UseExternalData(v_loc.Data(), h1dofs_cnt, dim);
+                     evaluator.GetZoneValues(e_loc, e_vals, 2, xv_loc, grads);
+                  }
+               }
+         }
+      }
+      sw.Stop();
+      time[k] = sw.RealTime();
+   }
+
+   // Sum the work and take the slowest task's time.
+   double my_data[3*num_kernels], data[3*num_kernels], time_max[num_kernels];
+   for (int k = 0; k < num_kernels; k++)
+   {
+      my_data[3*k]   = cost[k].flops;
+      my_data[3*k+1] = cost[k].bytes;
+      my_data[3*k+2] = dofs[k];
+   }
+   MPI_Reduce(my_data, data, 3*num_kernels, MPI_DOUBLE, MPI_SUM, 0,
+              pmesh->GetComm());
+   MPI_Reduce(time, time_max, num_kernels, MPI_DOUBLE, MPI_MAX, 0,
+              pmesh->GetComm());
+
+   const HYPRE_Int glob_zones = pmesh->GetGlobalNE();
+   const HYPRE_Int glob_size_l2 = L2FESpace.GlobalTrueVSize(),
+                   glob_size_h1 = H1FESpace.GlobalTrueVSize();
+   if (mpi.Root())
+   {
+      cout << endl << "Zones: " << glob_zones
+           << ", H1 dofs: " << glob_size_h1 << ", L2 dofs: " << glob_size_l2
+           << ", quadrature points per zone: " << nqp << endl << endl;
+      cout << left << setw(24) << "Kernel" << right << setw(12) << "time [s]"
+           << setw(12) << "GFLOP/s" << setw(12) << "GB/s"
+           << setw(12) << "flop/byte" << setw(12) << "Mdofs/s" << endl;
+      for (int k = 0; k < num_kernels; k++)
+      {
+         PrintRates(names[k], reps, time_max[k],
+                    KernelCost(data[3*k], data[3*k+1]), data[3*k+2]);
+      }
+   }
+
+   delete pmesh;
+   return 0;
+}
+
+static void SetQuadratureData(ParFiniteElementSpace &h1_fes,
+                              const IntegrationRule &ir,
+                              QuadratureData &quad_data)
+{
+   const int dim = h1_fes.GetMesh()->Dimension(),
+             nzones = h1_fes.GetMesh()->GetNE(), nqp = ir.GetNPoints();
+   DenseMatrix Jinv(dim);
+   for (int z = 0; z < nzones; z++)
+   {
+      ElementTransformation *T = h1_fes.GetElementTransformation(z);
+      for (int q = 0; q < nqp; q++)
+      {
+         const IntegrationPoint &ip = ir.IntPoint(q);
+         T->SetIntPoint(&ip);
+         const double detJ = T->Weight();
+         CalcInverse(T->Jacobian(), Jinv);
+         quad_data.Jac0inv(z*nqp + q) = Jinv;
+         quad_data.rho0DetJ0w(z*nqp + q) = detJ * ip.weight;
+
+         // stress = -p I with p = 1, see UpdateQuadratureData().
+         for (int vd = 0; vd < dim; vd++)
+         {
+            for (int gd = 0; gd < dim; gd++)
+            {
+               quad_data.stressJinvT(vd)(z*nqp + q, gd) =
+                  -Jinv(gd, vd) * detJ * ip.weight;
+            }
+         }
+      }
+   }
+   quad_data.dt_est = 1.0;
+}
+
+static void PrintRates(const char *name, int reps, double time,
+                       const KernelCost &cost, double dofs)
+{
+   const double t = time / reps;
+   cout << left << setw(24) << name << right << scientific << setprecision(4)
+        << setw(12) << time << fixed << setprecision(3)
+        << setw(12) << 1e-9 * cost.flops / t
+        << setw(12) << 1e-9 * cost.bytes / t
+        << setw(12) << cost.flops / cost.bytes
+        << setw(12) << 1e-6 * dofs / t << endl;
+}
@@ -0,0 +1,188 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#include "laghos_compat.hpp"
+
+#ifndef MFEM_USE_MPI
+
+#include <cstring>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+using namespace std;
+
+int MPI_Finalize() { return MPI_SUCCESS; }
+
+int MPI_Finalized(int *flag) { *flag = 0; return MPI_SUCCESS; }
+
+double MPI_Wtime()
+{
+   timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+int MPI_Comm_rank(MPI_Comm, int *rank) { *rank = 0; return MPI_SUCCESS; }
+
+int MPI_Comm_size(MPI_Comm, int *size) { *size = 1; return MPI_SUCCESS; }
+
+int MPI_Comm_split(MPI_Comm comm, int, int, MPI_Comm *newcomm)
+{
+   *newcomm = comm;
+   return MPI_SUCCESS;
+}
+
+int MPI_Comm_free(MPI_Comm *comm) { *comm = MPI_COMM_NULL; return MPI_SUCCESS; }
+
+int MPI_Type_contiguous(int count, MPI_Datatype type, MPI_Datatype *newtype)
+{
+   *newtype = count * type;
+   return MPI_SUCCESS;
+}
+
+int MPI_Type_commit(MPI_Datatype *) { return MPI_SUCCESS; }
+
+int MPI_Type_size(MPI_Datatype type, int *size)
+{
+   *size = type;
+   return MPI_SUCCESS;
+}
+
+int MPI_Type_free(MPI_Datatype *type)
+{
+   *type = MPI_DATATYPE_NULL;
+   return MPI_SUCCESS;
+}
+
+int MPI_Op_create(MPI_User_function *, int, MPI_Op *op)
+{
+   // Any operation leaves the values of a single task unchanged.
+   *op = MPI_SUM;
+   return MPI_SUCCESS;
+}
+
+int MPI_Barrier(MPI_Comm) { return MPI_SUCCESS; }
+
+int MPI_Bcast(void *, int, MPI_Datatype, int, MPI_Comm) { return MPI_SUCCESS; }
+
+int MPI_Reduce(const void *sbuf, void *rbuf, int count, MPI_Datatype type,
+               MPI_Op, int, MPI_Comm)
+{
+   if (rbuf != sbuf) { memcpy(rbuf, sbuf, (size_t) count * type); }
+   return MPI_SUCCESS;
+}
+
+int MPI_Allreduce(const void *sbuf, void *rbuf, int count, MPI_Datatype type,
+                  MPI_Op op, MPI_Comm comm)
+{
+   return MPI_Reduce(sbuf, rbuf, count, type, op, 0, comm);
+}
+
+int MPI_Exscan(const void *, void *, int, MPI_Datatype, MPI_Op, MPI_Comm)
+{
+   return MPI_SUCCESS;
+}
+
+int MPI_Gather(const void *sbuf, int scount, MPI_Datatype stype, void *rbuf,
+               int, MPI_Datatype, int, MPI_Comm)
+{
+   if (rbuf != sbuf) { memcpy(rbuf, sbuf, (size_t) scount * stype); }
+   return MPI_SUCCESS;
+}
+
+int MPI_Alltoall(const void *sbuf, int scount, MPI_Datatype stype,
+                 void *rbuf, int, MPI_Datatype, MPI_Comm)
+{
+   if (rbuf != sbuf) { memcpy(rbuf, sbuf, (size_t) scount * stype); }
+   return MPI_SUCCESS;
+}
+
+int MPI_Alltoallv(const void *sbuf, const int *scounts, const int *sdispls,
+                  MPI_Datatype stype, void *rbuf, const int *,
+                  const int *rdispls, MPI_Datatype, MPI_Comm)
+{
+   if (scounts[0] > 0)
+   {
+      memcpy((char *) rbuf + (size_t) rdispls[0] * stype,
+             (const char *) sbuf + (size_t) sdispls[0] * stype,
+             (size_t) scounts[0] * stype);
+   }
+   return MPI_SUCCESS;
+}
+
+int MPI_File_open(MPI_Comm, const char *name, int mode, MPI_Info,
+                  MPI_File *fh)
+{
+   // As in MPI, opening for writing neither truncates nor creates the file,
+   // unless MPI_MODE_CREATE is given.
+   if (mode & MPI_MODE_RDONLY) { *fh = fopen(name, "rb"); }
+   else
+   {
+      *fh = fopen(name, "r+b");
+      if (!*fh && (mode & MPI_MODE_CREATE)) { *fh = fopen(name, "w+b"); }
+   }
+   return *fh ? MPI_SUCCESS : MPI_ERR_FILE;
+}
+
+int MPI_File_close(MPI_File *fh)
+{
+   const int err = fclose(*fh);
+   *fh = NULL;
+   return err ? MPI_ERR_FILE : MPI_SUCCESS;
+}
+
+int MPI_File_set_size(MPI_File fh, MPI_Offset size)
+{
+   fflush(fh);
+   return ftruncate(fileno(fh), (off_t) size) ? MPI_ERR_FILE : MPI_SUCCESS;
+}
+
+int MPI_File_read_at(MPI_File fh, MPI_Offset offset, void *buf, int count,
+                     MPI_Datatype type, MPI_Status *)
+{
+   if (fseeko(fh, (off_t) offset, SEEK_SET) != 0 ||
+       fread(buf, type, count, fh) != (size_t) count)
+   {
+      return MPI_ERR_FILE;
+   }
+   return MPI_SUCCESS;
+}
+
+int MPI_File_read_at_all(MPI_File fh, MPI_Offset offset, void *buf,
+                         int count, MPI_Datatype type, MPI_Status *status)
+{
+   return MPI_File_read_at(fh, offset, buf, count, type, status);
+}
+
+int MPI_File_write_at(MPI_File fh, MPI_Offset offset, const void *buf,
+                      int count, MPI_Datatype type, MPI_Status *)
+{
+   if (fseeko(fh, (off_t) offset, SEEK_SET) != 0 ||
+       fwrite(buf, type, count, fh) != (size_t) count)
+   {
+      return MPI_ERR_FILE;
+   }
+   return MPI_SUCCESS;
+}
+
+int MPI_File_write_at_all(MPI_File fh, MPI_Offset offset, const void *buf,
+                          int count, MPI_Datatype type, MPI_Status *status)
+{
+   return MPI_File_write_at(fh, offset, buf, count, type, status);
+}
+
+#endif // MFEM_USE_MPI
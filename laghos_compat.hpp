@@ -0,0 +1,190 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_COMPAT
+#define MFEM_LAGHOS_COMPAT
+
+#include "mfem.hpp"
+
+// Laghos is written against the parallel MFEM interface. When MFEM is built
+// without MPI, the declarations below stand in for the MPI calls and the
+// parallel MFEM classes that Laghos uses, for a single task: the collectives
+// copy the local values, MPI-IO goes through stdio, and the Par* classes are
+// the serial MFEM classes with the few parallel methods Laghos calls. The same
+// sources then build a shared-memory executable, without MPI and hypre, whose
+// quadrature point computations can still be threaded with OpenMP.
+#ifndef MFEM_USE_MPI
+
+#include <cstdio>
+#include <iostream>
+
+typedef int MPI_Comm;
+// The size of the type in bytes.
+typedef int MPI_Datatype;
+typedef int MPI_Op;
+typedef int MPI_Info;
+typedef long long MPI_Offset;
+typedef std::FILE *MPI_File;
+struct MPI_Status { int MPI_SOURCE, MPI_TAG, MPI_ERROR; };
+typedef void MPI_User_function(void *, void *, int *, MPI_Datatype *);
+
+#define MPI_VERSION 3
+#define MPI_SUCCESS 0
+#define MPI_ERR_FILE 27
+
+#define MPI_COMM_NULL 0
+#define MPI_COMM_WORLD 1
+#define MPI_COMM_SELF 2
+
+#define MPI_DATATYPE_NULL 0
+#define MPI_CHAR ((MPI_Datatype) sizeof(char))
+#define MPI_INT ((MPI_Datatype) sizeof(int))
+#define MPI_LONG_LONG ((MPI_Datatype) sizeof(long long))
+#define MPI_DOUBLE ((MPI_Datatype) sizeof(double))
+
+#define MPI_OP_NULL 0
+#define MPI_SUM 1
+#define MPI_MIN 2
+#define MPI_MAX 3
+
+#define MPI_STATUS_IGNORE ((MPI_Status *) 0)
+#define MPI_INFO_NULL 0
+
+#define MPI_MODE_CREATE 1
+#define MPI_MODE_RDONLY 2
+#define MPI_MODE_WRONLY 4
+
+typedef int HYPRE_Int;
+#define HYPRE_MPI_INT MPI_INT
+
+int MPI_Finalize();
+int MPI_Finalized(int *flag);
+double MPI_Wtime();
+
+int MPI_Comm_rank(MPI_Comm comm, int *rank);
+int MPI_Comm_size(MPI_Comm comm, int *size);
+int MPI_Comm_split(MPI_Comm comm, int color, int key, MPI_Comm *newcomm);
+int MPI_Comm_free(MPI_Comm *comm);
+
+int MPI_Type_contiguous(int count, MPI_Datatype type, MPI_Datatype *newtype);
+int MPI_Type_commit(MPI_Datatype *type);
+int MPI_Type_size(MPI_Datatype type, int *size);
+int MPI_Type_free(MPI_Datatype *type);
+int MPI_Op_create(MPI_User_function *function, int commute, MPI_Op *op);
+
+int MPI_Barrier(MPI_Comm comm);
+int MPI_Bcast(void *buf, int count, MPI_Datatype type, int root,
+              MPI_Comm comm);
+int MPI_Reduce(const void *sbuf, void *rbuf, int count, MPI_Datatype type,
+               MPI_Op op, int root, MPI_Comm comm);
+int MPI_Allreduce(const void *sbuf, void *rbuf, int count, MPI_Datatype type,
+                  MPI_Op op, MPI_Comm comm);
+// Leaves rbuf unchanged: the result is undefined on the first task.
+int MPI_Exscan(const void *sbuf, void *rbuf, int count, MPI_Datatype type,
+               MPI_Op op, MPI_Comm comm);
+int MPI_Gather(const void *sbuf, int scount, MPI_Datatype stype, void *rbuf,
+               int rcount, MPI_Datatype rtype, int root, MPI_Comm comm);
+int MPI_Alltoall(const void *sbuf, int scount, MPI_Datatype stype,
+                 void *rbuf, int rcount, MPI_Datatype rtype, MPI_Comm comm);
+int MPI_Alltoallv(const void *sbuf, const int *scounts, const int *sdispls,
+                  MPI_Datatype stype, void *rbuf, const int *rcounts,
+                  const int *rdispls, MPI_Datatype rtype, MPI_Comm comm);
+
+int MPI_File_open(MPI_Comm comm, const char *name, int mode, MPI_Info info,
+                  MPI_File *fh);
+int MPI_File_close(MPI_File *fh);
+int MPI_File_set_size(MPI_File fh, MPI_Offset size);
+int MPI_File_read_at(MPI_File fh, MPI_Offset offset, void *buf, int count,
+                     MPI_Datatype type, MPI_Status *status);
+int MPI_File_read_at_all(MPI_File fh, MPI_Offset offset, void *buf,
+                         int count, MPI_Datatype type, MPI_Status *status);
+int MPI_File_write_at(MPI_File fh, MPI_Offset offset, const void *buf,
+                      int count, MPI_Datatype type, MPI_Status *status);
+int MPI_File_write_at_all(MPI_File fh, MPI_Offset offset, const void *buf,
+                          int count, MPI_Datatype type, MPI_Status *status);
+
+namespace mfem
+{
+
+class MPI_Session
+{
+public:
+   MPI_Session() { }
+   MPI_Session(int &, char **&) { }
+   int WorldRank() const { return 0; }
+   int WorldSize() const { return 1; }
+   bool Root() const { return true; }
+};
+
+// The whole mesh, on the only task.
+class ParMesh : public Mesh
+{
+protected:
+   MPI_Comm MyComm;
+
+public:
+   ParMesh(MPI_Comm comm, Mesh &mesh, int * = NULL, int = 1)
+      : Mesh(mesh, true), MyComm(comm) { }
+   // Reads a mesh written by ParPrint().
+   ParMesh(MPI_Comm comm, std::istream &input, bool = true)
+      : Mesh(input, 1, 1), MyComm(comm) { }
+
+   MPI_Comm GetComm() const { return MyComm; }
+   int GetNRanks() const { return 1; }
+   int GetMyRank() const { return 0; }
+   long GetGlobalNE() const { return GetNE(); }
+
+   void ParPrint(std::ostream &out) const { Print(out); }
+   void PrintAsOne(std::ostream &out) { Print(out); }
+};
+
+class ParFiniteElementSpace : public FiniteElementSpace
+{
+public:
+   ParFiniteElementSpace(ParMesh *pm, const FiniteElementCollection *f,
+                         int dim = 1, int ordering = Ordering::byNODES)
+      : FiniteElementSpace(pm, f, dim, ordering) { }
+
+   ParMesh *GetParMesh() const { return static_cast<ParMesh *>(GetMesh()); }
+   MPI_Comm GetComm() const { return GetParMesh()->GetComm(); }
+   int GetNRanks() const { return 1; }
+   int GetMyRank() const { return 0; }
+   HYPRE_Int GlobalTrueVSize() const { return GetTrueVSize(); }
+};
+
+class ParGridFunction : public GridFunction
+{
+public:
+   ParGridFunction() { }
+   ParGridFunction(ParFiniteElementSpace *pf) : GridFunction(pf) { }
+
+   using GridFunction::operator=;
+
+   ParFiniteElementSpace *ParFESpace() const
+   { return static_cast<ParFiniteElementSpace *>(fes); }
+
+   void SaveAsOne(std::ostream &out) { Save(out); }
+};
+
+typedef BilinearForm ParBilinearForm;
+// The assembled matrix of a ParBilinearForm.
+typedef SparseMatrix HypreParMatrix;
+
+} // namespace mfem
+
+#endif // MFEM_USE_MPI
+
+#endif // MFEM_LAGHOS_COMPAT
@@ -0,0 +1,198 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+
+#include "laghos_diagnostics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+using namespace std;
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+enum { REDUCE_MIN, REDUCE_MAX, REDUCE_SUM };
+
+static const int header_size = 3;
+
+// The combined min / max / sum operation on whole buffers. The buffer is a
+// single element of a contiguous type, so MPI never splits it and every
+// element starts with its header.
+static void ReduceValues(void *in, void *inout, int *len, MPI_Datatype *)
+{
+   const double *a = (const double *) in;
+   double *b = (double *) inout;
+   for (int k = 0; k < *len; k++)
+   {
+      const int n_min = (int) b[0], n_max = (int) b[1], n_sum = (int) b[2];
+      const int n = header_size + n_min + n_max + n_sum;
+      int i = header_size;
+      for ( ; i < header_size + n_min; i++) { b[i] = min(a[i], b[i]); }
+      for ( ; i < n - n_sum; i++) { b[i] = max(a[i], b[i]); }
+      for ( ; i < n; i++) { b[i] += a[i]; }
+      a += n;
+      b += n;
+   }
+}
+
+static MPI_Op reduce_op = MPI_OP_NULL;
+
+GlobalReduction::GlobalReduction(MPI_Comm comm_)
+   : comm(comm_), type(MPI_DATATYPE_NULL), done(false)
+{
+   // The operation is kept until MPI_Finalize.
+   if (reduce_op == MPI_OP_NULL) { MPI_Op_create(ReduceValues, 1, &reduce_op); }
+}
+
+GlobalReduction::~GlobalReduction()
+{
+   FreeType();
+}
+
+void GlobalReduction::FreeType()
+{
+   int finalized;
+   MPI_Finalized(&finalized);
+   if (type != MPI_DATATYPE_NULL && !finalized) { MPI_Type_free(&type); }
+   type = MPI_DATATYPE_NULL;
+}
+
+void GlobalReduction::Clear()
+{
+   min_vals.clear();
+   max_vals.clear();
+   sum_vals.clear();
+   slot_op.clear();
+   slot_pos.clear();
+   done = false;
+}
+
+int GlobalReduction::AddSlot(int op, vector<double> &vals, double value)
+{
+   slot_op.push_back(op);
+   slot_pos.push_back((int) vals.size());
+   vals.push_back(value);
+   done = false;
+   return (int) slot_op.size() - 1;
+}
+
+int GlobalReduction::Min(double value)
+{
+   return AddSlot(REDUCE_MIN, min_vals, value);
+}
+
+int GlobalReduction::Max(double value)
+{
+   return AddSlot(REDUCE_MAX, max_vals, value);
+}
+
+int GlobalReduction::Sum(double value)
+{
+   return AddSlot(REDUCE_SUM, sum_vals, value);
+}
+
+void GlobalReduction::Pack()
+{
+   const int n_min = min_vals.size(), n_max = max_vals.size(),
+             n_sum = sum_vals.size(),
+             n = header_size + n_min + n_max + n_sum;
+   buf.resize(n);
+   res.resize(n);
+   buf[0] = n_min; buf[1] = n_max; buf[2] = n_sum;
+   copy(min_vals.begin(), min_vals.end(), buf.begin() + header_size);
+   copy(max_vals.begin(), max_vals.end(), buf.begin() + header_size + n_min);
+   copy(sum_vals.begin(), sum_vals.end(),
+        buf.begin() + header_size + n_min + n_max);
+
+   int type_size = 0;
+   if (type != MPI_DATATYPE_NULL) { MPI_Type_size(type, &type_size); }
+   if (type_size != n * (int) sizeof(double))
+   {
+      FreeType();
+      MPI_Type_contiguous(n, MPI_DOUBLE, &type);
+      MPI_Type_commit(&type);
+   }
+}
+
+void GlobalReduction::Reduce()
+{
+   Pack();
+   MPI_Allreduce(&buf[0], &res[0], 1, type, reduce_op, comm);
+   done = true;
+}
+
+double GlobalReduction::Get(int slot) const
+{
+   MFEM_VERIFY(done, "The reduction is not complete.");
+   const int n_min = min_vals.size(), n_max = max_vals.size();
+   int pos = header_size + slot_pos[slot];
+   if (slot_op[slot] != REDUCE_MIN) { pos += n_min; }
+   if (slot_op[slot] == REDUCE_SUM) { pos += n_max; }
+   return res[pos];
+}
+
+ConservationMonitor::ConservationMonitor(MPI_Comm comm, int dim_,
+                                         const char *file)
+   : dim(dim_), energy0(0.0), energy_change(0.0), first(true)
+{
+   int myid;
+   MPI_Comm_rank(comm, &myid);
+   if (myid != 0) { return; }
+   out.open(file);
+   MFEM_VERIFY(out, "Cannot open the conservation file " << file);
+   out << "# step time mass";
+   for (int d = 0; d < dim; d++) { out << " momentum_" << char('x' + d); }
+   out << " kinetic_energy internal_energy total_energy" << endl;
+   out << scientific << setprecision(16);
+}
+
+void ConservationMonitor::Add(const Vector &local_totals,
+                              GlobalReduction &reduction)
+{
+   MFEM_VERIFY(local_totals.Size() == dim + 3, "Wrong number of totals.");
+   slots.resize(dim + 3);
+   for (int i = 0; i < dim + 3; i++)
+   {
+      slots[i] = reduction.Sum(local_totals(i));
+   }
+}
+
+void ConservationMonitor::Write(int step, double t,
+                                const GlobalReduction &reduction)
+{
+   const double kinetic = reduction.Get(slots[dim + 1]),
+                internal = reduction.Get(slots[dim + 2]),
+                energy = kinetic + internal;
+   if (first) { energy0 = energy; first = false; }
+   else if (energy0 != 0.0)
+   {
+      const double change = fabs(energy - energy0) / fabs(energy0);
+      energy_change = max(energy_change, change);
+   }
+   if (!out.is_open()) { return; }
+
+   out << step << " " << t;
+   for (int i = 0; i < dim + 3; i++) { out << " " << reduction.Get(slots[i]); }
+   out << " " << energy << endl;
+}
+
+} // namespace hydrodynamics
+
+} // namespace mfem
@@ -0,0 +1,101 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_DIAGNOSTICS
+#define MFEM_LAGHOS_DIAGNOSTICS
+
+#include "laghos_compat.hpp"
+
+#include <fstream>
+#include <vector>
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// Global reduction of a set of per-step scalars, e.g., the time step estimate
+// (min), norms and totals (sum), with a single MPI_Allreduce. The local values
+// are registered with Min(), Max() or Sum(), which return the slot of the
+// value, and the global values are read with Get() after Reduce(). All ranks
+// must register the same slots in the same order.
+class GlobalReduction
+{
+private:
+   MPI_Comm comm;
+   // The buffer is a header (the numbers of min, max and sum values) followed
+   // by the min, max and sum values; slot_pos maps the slots to positions in
+   // the buffer.
+   std::vector<double> min_vals, max_vals, sum_vals, buf, res;
+   std::vector<int> slot_op, slot_pos;
+   MPI_Datatype type;
+   bool done;
+
+   int AddSlot(int op, std::vector<double> &vals, double value);
+   void Pack();
+   void FreeType();
+
+public:
+   GlobalReduction(MPI_Comm comm_);
+   ~GlobalReduction();
+
+   // Starts a new set of values.
+   void Clear();
+
+   int Min(double value);
+   int Max(double value);
+   int Sum(double value);
+
+   // Reduces the values with one MPI_Allreduce. Collective.
+   void Reduce();
+
+   // Global value of a slot.
+   double Get(int slot) const;
+};
+
+// Time series of the conserved totals of a run: mass, momentum, kinetic,
+// internal and total energy, one line per recorded state, written by rank 0.
+// The local totals of a state (see
+// LagrangianHydroOperator::ComputeLocalTotals) are added to a GlobalReduction,
+// so they share its MPI_Allreduce, and Write() records the reduced values.
+class ConservationMonitor
+{
+private:
+   const int dim;
+   std::ofstream out;
+   std::vector<int> slots;
+   double energy0, energy_change;
+   bool first;
+
+public:
+   ConservationMonitor(MPI_Comm comm, int dim_, const char *file);
+
+   // Registers the local totals of a state. Collective through the reduction.
+   void Add(const Vector &local_totals, GlobalReduction &reduction);
+
+   // Records the reduced totals of the state added last.
+   void Write(int step, double t, const GlobalReduction &reduction);
+
+   // Largest relative change of the total energy from the first record.
+   double EnergyChange() const { return energy_change; }
+};
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_LAGHOS_DIAGNOSTICS
@@ -0,0 +1,414 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+//
+//                       Laghos ensemble driver
+//
+// Runs an ensemble of small, independent Laghos simulations in one job, e.g.,
+// for uncertainty quantification, instead of one job per simulation. The
+// members differ in the ideal gas constant, the CFL number and the scale of
+// the initial internal energy, sampled uniformly from the given ranges. Each
+// member is a complete simulation on a single MPI task: its mesh lives on
+// MPI_COMM_SELF, and it has its own LagrangianHydroOperator (with its own
+// partial assembly tables), ODE solver and time step control. The members are
+// distributed round-robin over the tasks, and the members of a task are
+// advanced in turn, one time step each, until all of them reach the final
+// time. The serial mesh is read and refined once.
+//
+// The result file has one line per member: its parameters, the accepted and
+// rejected steps, the final time, the energy norm and the relative change of
+// the total energy. A member whose time step collapses is marked as failed and
+// doesn't stop the others.
+//
+// Sample runs:
+//    mpirun -np 4 laghos_ensemble -p 1 -m data/square01_quad.mesh -rs 2
+//                                 -tf 0.8 -n 64 -gmin 1.3 -gmax 1.7
+//    mpirun -np 4 laghos_ensemble -p 0 -m data/square01_quad.mesh -rs 2
+//                                 -tf 0.5 -n 32 -cmin 0.2 -cmax 0.5
+
+#include "laghos_solver.hpp"
+#include "laghos_timeinteg.hpp"
+#include "laghos_problem.hpp"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+
+using namespace std;
+using namespace mfem;
+using namespace mfem::hydrodynamics;
+
+// Options shared by all members of the ensemble.
+struct EnsembleOptions
+{
+   int problem, order_v, order_e, ode_solver_type, dt_control, max_tsteps;
+   int cg_max_iter;
+   double t_final, cg_tol;
+   bool p_assembly;
+};
+
+// One simulation of the ensemble, on the calling task.
+class EnsembleMember
+{
+private:
+   const EnsembleOptions &opts;
+   ProblemSetup setup;
+   const double cfl;
+
+   ParMesh *pmesh;
+   L2_FECollection L2FEC;
+   H1_FECollection H1FEC;
+   ParFiniteElementSpace L2FESpace, H1FESpace;
+   Array<int> ess_tdofs, true_offset;
+   // The accepted state and the buffer of the next one, see laghos.cpp.
+   BlockVector *S_cur, *S_next;
+   ParGridFunction x_gf, v_gf, e_gf;
+   Coefficient *material;
+   LagrangianHydroOperator *oper;
+   HydroODESolver *ode_solver;
+   TimeStepController *dt_controller;
+
+   double t, dt, energy0;
+
+   // Total energy of the current state.
+   double TotalEnergy() const;
+
+public:
+   int steps, rejected;
+   bool done, failed;
+
+   EnsembleMember(const EnsembleOptions &opts_, const Mesh &mesh,
+                  double gamma, double cfl_, double energy_scale);
+
+   // Makes one time step, or one attempt of it, if the member isn't done.
+   void Step();
+
+   // Parameters and results, in the columns of the result file.
+   static const int num_values = 9;
+   void GetValues(double *values) const;
+
+   ~EnsembleMember();
+};
+
+int main(int argc, char *argv[])
+{
+   // Initialize MPI.
+   MPI_Session mpi(argc, argv);
+   const int myid = mpi.WorldRank(), num_procs = mpi.WorldSize();
+
+   // Parse command-line options.
+   EnsembleOptions opts;
+   opts.problem = 1;
+   opts.order_v = 2;
+   opts.order_e = 1;
+   opts.ode_solver_type = 4;
+   opts.dt_control = 0;
+   opts.max_tsteps = -1;
+   opts.cg_max_iter = 300;
+   opts.t_final = 0.5;
+   opts.cg_tol = 1e-8;
+   opts.p_assembly = true;
+   const char *mesh_file = "data/square01_quad.mesh";
+   int rs_levels = 0;
+   int num_members = 16;
+   double gamma_min = 0.0, gamma_max = 0.0;
+   double cfl_min = 0.5, cfl_max = 0.5;
+   double energy_min = 1.0, energy_max = 1.0;
+   int seed = 1;
+   const char *result_file = "Laghos_ensemble.txt";
+
+   OptionsParser args(argc, argv);
+   args.AddOption(&mesh_file, "-m", "--mesh", "Mesh file to use.");
+   args.AddOption(&rs_levels, "-rs", "--refine-serial",
+                  "Number of times to refine the mesh uniformly.");
+   args.AddOption(&opts.problem, "-p", "--problem", "Problem setup to use.");
+   args.AddOption(&opts.order_v, "-ok", "--order-kinematic",
+                  "Order (degree) of the kinematic finite element space.");
+   args.AddOption(&opts.order_e, "-ot", "--order-thermo",
+                  "Order (degree) of the thermodynamic finite element space.");
+   args.AddOption(&opts.ode_solver_type, "-s", "--ode-solver",
+                  "ODE solver, as in laghos.");
+   args.AddOption(&opts.dt_control, "-dtc", "--dt-control",
+                  "Time step control, as in laghos.");
+   args.AddOption(&opts.t_final, "-tf", "--t-final",
+                  "Final time; start time is 0.");
+   args.AddOption(&opts.max_tsteps, "-ms", "--max-steps",
+                  "Maximum number of steps (negative means no restriction).");
+   args.AddOption(&opts.cg_tol, "-cgt", "--cg-tol",
+                  "Relative CG tolerance (velocity linear solve).");
+   args.AddOption(&opts.cg_max_iter, "-cgm", "--cg-max-steps",
+                  "Maximum number of CG iterations (velocity linear solve).");
+   args.AddOption(&opts.p_assembly, "-pa", "--partial-assembly", "-fa",
+                  "--full-assembly",
+                  "Activate 1D tensor-based assembly (partial assembly).");
+   args.AddOption(&num_members, "-n", "--members",
+                  "Number of members of the ensemble.");
+   args.AddOption(&gamma_min, "-gmin", "--gamma-min",
+                  "Smallest ideal gas constant (0: the one of the problem).");
+   args.AddOption(&gamma_max, "-gmax", "--gamma-max",
+                  "Largest ideal gas constant.");
+   args.AddOption(&cfl_min, "-cmin", "--cfl-min", "Smallest CFL number.");
+   args.AddOption(&cfl_max, "-cmax", "--cfl-max", "Largest CFL number.");
+   args.AddOption(&energy_min, "-emin", "--energy-min",
+                  "Smallest scale of the initial internal energy.");
+   args.AddOption(&energy_max, "-emax", "--energy-max",
+                  "Largest scale of the initial internal energy.");
+   args.AddOption(&seed, "-seed", "--seed",
+                  "Seed of the parameter samples.");
+   args.AddOption(&result_file, "-o", "--output",
+                  "File with the parameters and results of the members.");
+   args.Parse();
+   if (!args.Good() || num_members < 1 || !ProblemSetup(opts.problem).Valid())
+   {
+      if (mpi.Root()) { args.PrintUsage(cout); }
+      return 1;
+   }
+   if (mpi.Root()) { args.PrintOptions(cout); }
+
+   StopWatch sw_setup, sw_run;
+   sw_setup.Start();
+   Mesh *mesh = new Mesh(mesh_file, 1, 1);
+   for (int lev = 0; lev < rs_levels; lev++) { mesh->UniformRefinement(); }
+   if (opts.p_assembly && mesh->Dimension() == 1)
+   {
+      opts.p_assembly = false;
+      if (mpi.Root())
+      {
+         cout << "Laghos does not support PA in 1D. Switching to FA." << endl;
+      }
+   }
+
+   // The same samples on all tasks; each task sets up its own members.
+   Vector samples(3 * num_members);
+   samples.Randomize(seed);
+   Array<EnsembleMember *> members;
+   for (int i = myid; i < num_members; i += num_procs)
+   {
+      const double *r = samples.GetData() + 3*i;
+      members.Append(new EnsembleMember(opts, *mesh,
+                                        gamma_min + r[0]*(gamma_max-gamma_min),
+                                        cfl_min + r[1]*(cfl_max - cfl_min),
+                                        energy_min +
+                                        r[2]*(energy_max - energy_min)));
+   }
+   delete mesh;
+   sw_setup.Stop();
+
+   // Advance the members in turn until all of them are done.
+   sw_run.Start();
+   int active = members.Size();
+   while (active > 0)
+   {
+      active = 0;
+      for (int m = 0; m < members.Size(); m++)
+      {
+         members[m]->Step();
+         if (!members[m]->done) { active++; }
+      }
+   }
+   sw_run.Stop();
+
+   // Collect the results of all members on the root.
+   const int nv = EnsembleMember::num_values;
+   Vector values(nv * num_members), all_values(nv * num_members);
+   values = 0.0;
+   int my_steps = 0, steps;
+   for (int m = 0; m < members.Size(); m++)
+   {
+      const int i = myid + m * num_procs;
+      members[m]->GetValues(values.GetData() + nv*i);
+      my_steps += members[m]->steps + members[m]->rejected;
+   }
+   MPI_Reduce(values.GetData(), all_values.GetData(), nv * num_members,
+              MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+   MPI_Reduce(&my_steps, &steps, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+   double times[2] = { sw_setup.RealTime(), sw_run.RealTime() }, max_times[2];
+   MPI_Reduce(times, max_times, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+   if (mpi.Root())
+   {
+      ofstream out(result_file);
+      MFEM_VERIFY(out, "Cannot open the result file " << result_file);
+      out << "# member gamma cfl energy_scale steps rejected t e_norm"
+          << " energy_change failed" << endl;
+      out << setprecision(10);
+      int failed = 0;
+      for (int i = 0; i < num_members; i++)
+      {
+         const double *v = all_values.GetData() + nv*i;
+         out << i;
+         for (int k = 0; k < nv; k++) { out << " " << v[k]; }
+         out << endl;
+         if (v[nv-1] != 0.0) { failed++; }
+      }
+
+      cout << endl << "Members: " << num_members << " on " << num_procs
+           << " tasks, " << failed << " failed" << endl;
+      cout << "Setup time (seconds): " << max_times[0] << endl;
+      cout << "Run time (seconds): " << max_times[1] << endl;
+      cout << "Time steps of all members (including repeated ones): "
+           << steps << endl;
+      if (max_times[1] > 0.0)
+      {
+         cout << "Members / second: " << num_members / max_times[1] << endl;
+         cout << "Time steps / second: " << steps / max_times[1] << endl;
+      }
+      cout << "Results written to " << result_file << endl;
+   }
+
+   for (int m = 0; m < members.Size(); m++) { delete members[m]; }
+   return 0;
+}
+
+EnsembleMember::EnsembleMember(const EnsembleOptions &opts_, const Mesh &mesh,
+                               double gamma, double cfl_, double energy_scale)
+   : opts(opts_), setup(opts_.problem), cfl(cfl_),
+     pmesh(new ParMesh(MPI_COMM_SELF, const_cast<Mesh &>(mesh))),
+     L2FEC(opts.order_e, mesh.Dimension(), BasisType::Positive),
+     H1FEC(opts.order_v, mesh.Dimension()),
+     L2FESpace(pmesh, &L2FEC), H1FESpace(pmesh, &H1FEC, mesh.Dimension()),
+     true_offset(4), S_cur(NULL), S_next(NULL), material(NULL), oper(NULL),
+     ode_solver(NULL), dt_controller(NULL), t(0.0), dt(0.0), energy0(0.0),
+     steps(0), rejected(0), done(false), failed(false)
+{
+   const int dim = pmesh->Dimension();
+   setup.gamma_value = gamma;
+   setup.energy_scale = energy_scale;
+
+   // Boundary conditions: v.n = 0 on the straight boundaries, as in laghos.
+   Array<int> ess_bdr(pmesh->bdr_attributes.Max()), tdofs1d;
+   for (int d = 0; d < dim; d++)
+   {
+      ess_bdr = 0; ess_bdr[d] = 1;
+      H1FESpace.GetEssentialTrueDofs(ess_bdr, tdofs1d, d);
+      ess_tdofs.Append(tdofs1d);
+   }
+
+   switch (opts.ode_solver_type)
+   {
+      case 1: ode_solver = new ForwardEulerHydroSolver; break;
+      case 2: ode_solver = new RK2HydroSolver(0.5); break;
+      case 3: ode_solver = new RK3SSPHydroSolver; break;
+      case 4: ode_solver = new RK4HydroSolver; break;
+      case 6: ode_solver = new RK6HydroSolver; break;
+      case 7: ode_solver = new RK2AvgSolver; break;
+      case 8: ode_solver = new LowStorageRKSolver(3); break;
+      case 9: ode_solver = new LowStorageRKSolver(4); break;
+      default: MFEM_ABORT("Unknown ODE solver type: " << opts.ode_solver_type);
+   }
+   switch (opts.dt_control)
+   {
+      case 0: dt_controller = new FixedFactorController; break;
+      case 1: dt_controller = new PredictiveController; break;
+      default: MFEM_ABORT("Unknown time step control: " << opts.dt_control);
+   }
+
+   const int Vsize_h1 = H1FESpace.GetVSize(), Vsize_l2 = L2FESpace.GetVSize();
+   true_offset[0] = 0;
+   true_offset[1] = true_offset[0] + Vsize_h1;
+   true_offset[2] = true_offset[1] + Vsize_h1;
+   true_offset[3] = true_offset[2] + Vsize_l2;
+   S_cur = new BlockVector(true_offset);
+   S_next = new BlockVector(true_offset);
+   x_gf.MakeRef(&H1FESpace, *S_cur, true_offset[0]);
+   v_gf.MakeRef(&H1FESpace, *S_cur, true_offset[1]);
+   e_gf.MakeRef(&L2FESpace, *S_cur, true_offset[2]);
+   pmesh->SetNodalGridFunction(&x_gf);
+
+   ParGridFunction rho(&L2FESpace);
+   setup.ProjectInitialConditions(rho, &v_gf, &e_gf);
+   material = new ProblemCoefficient(setup, ProblemCoefficient::GAMMA);
+   oper = new LagrangianHydroOperator(S_cur->Size(), H1FESpace, L2FESpace,
+                                      ess_tdofs, rho, setup.SourceType(dim),
+                                      cfl, material, setup.Viscosity(),
+                                      opts.p_assembly, false,
+                                      opts.cg_tol, opts.cg_max_iter);
+   oper->SetSourceScale(setup.SourceScale());
+   ode_solver->Init(*oper);
+   energy0 = TotalEnergy();
+   oper->ResetTimeStepEstimate();
+   dt = oper->GetTimeStepEstimate(*S_cur);
+}
+
+double EnsembleMember::TotalEnergy() const
+{
+   Vector totals;
+   oper->ComputeLocalTotals(*S_cur, totals);
+   const int dim = pmesh->Dimension();
+   return totals(dim + 1) + totals(dim + 2);
+}
+
+void EnsembleMember::Step()
+{
+   if (done) { return; }
+
+   bool last_step = false;
+   if (t + dt >= opts.t_final)
+   {
+      dt = opts.t_final - t;
+      last_step = true;
+   }
+   if (steps + 1 == opts.max_tsteps) { last_step = true; }
+
+   const double t_old = t;
+   oper->ResetTimeStepEstimate();
+   ode_solver->Advance(*S_cur, *S_next, t, dt);
+
+   const double dt_est = oper->GetTimeStepEstimate(*S_next);
+   if (!dt_controller->Update(dt_est, dt))
+   {
+      t = t_old;
+      oper->ResetQuadratureData();
+      rejected++;
+      if (dt < numeric_limits<double>::epsilon()) { done = failed = true; }
+      return;
+   }
+
+   // Accept the step, see laghos.cpp.
+   BlockVector *S_tmp = S_cur;
+   S_cur = S_next;
+   S_next = S_tmp;
+   x_gf.MakeRef(&H1FESpace, *S_cur, true_offset[0]);
+   v_gf.MakeRef(&H1FESpace, *S_cur, true_offset[1]);
+   e_gf.MakeRef(&L2FESpace, *S_cur, true_offset[2]);
+   pmesh->NewNodes(x_gf, false);
+   steps++;
+   if (last_step) { done = true; }
+}
+
+void EnsembleMember::GetValues(double *values) const
+{
+   const Vector &e = S_cur->GetBlock(2);
+   const double energy = TotalEnergy();
+   values[0] = setup.gamma_value;
+   values[1] = cfl;
+   values[2] = setup.energy_scale;
+   values[3] = steps;
+   values[4] = rejected;
+   values[5] = t;
+   values[6] = sqrt(e * e);
+   values[7] = (energy0 != 0.0) ? fabs(energy - energy0) / fabs(energy0) : 0.0;
+   values[8] = failed ? 1.0 : 0.0;
+}
+
+EnsembleMember::~EnsembleMember()
+{
+   delete oper;
+   delete material;
+   delete dt_controller;
+   delete ode_solver;
+   delete S_next;
+   delete S_cur;
+   delete pmesh;
+}
@@ -0,0 +1,732 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#include "laghos_io.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+AggregatedOutput::AggregatedOutput(ParMesh &pmesh_, int nfiles)
+   : comm(pmesh_.GetComm()), pmesh(pmesh_)
+{
+   MPI_Comm_rank(comm, &myid);
+   MPI_Comm_size(comm, &num_procs);
+
+   // At least one and at most one file per rank.
+   num_files = min(max(nfiles, 1), num_procs);
+
+   // Contiguous blocks of ranks share a file.
+   file_id = (int) ((long long) myid * num_files / num_procs);
+   MPI_Comm_split(comm, file_id, myid, &file_comm);
+}
+
+void AggregatedOutput::RegisterField(const char *name, ParGridFunction *gf)
+{
+   field_names.push_back(name);
+   fields.push_back(gf);
+}
+
+void AggregatedOutput::Save(const char *prefix, int cycle, double time)
+{
+   // Serialize the local mesh and fields into one contiguous block, recording
+   // the size of each section.
+   const int nsect = 1 + fields.size();
+   vector<long long> info(2 + nsect);
+   ostringstream block;
+   block.precision(8);
+   streamoff prev = 0;
+   pmesh.Print(block);
+   info[2] = block.tellp() - prev; prev = block.tellp();
+   for (int f = 0; f < nsect - 1; f++)
+   {
+      fields[f]->Save(block);
+      info[3 + f] = block.tellp() - prev; prev = block.tellp();
+   }
+   const string data = block.str();
+   const long long block_size = data.size();
+   MFEM_VERIFY(block_size <= INT_MAX,
+               "The local output block exceeds 2 GB, increase the number of "
+               "MPI tasks.");
+
+   // Offset of this rank's block inside the shared file.
+   long long offset = 0;
+   MPI_Exscan(&block_size, &offset, 1, MPI_LONG_LONG, MPI_SUM, file_comm);
+   int file_rank;
+   MPI_Comm_rank(file_comm, &file_rank);
+   if (file_rank == 0) { offset = 0; }
+   info[0] = file_id;
+   info[1] = offset;
+
+   ostringstream name;
+   name << prefix << "_" << cycle;
+   ostringstream file_name;
+   file_name << name.str() << ".data."
+             << setfill('0') << setw(6) << file_id;
+
+   const string fname = file_name.str();
+   MPI_File fh;
+   int err = MPI_File_open(file_comm, const_cast<char *>(fname.c_str()),
+                           MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                           &fh);
+   MFEM_VERIFY(err == MPI_SUCCESS, "Cannot open " << fname);
+   // Remove the contents of older files with the same name.
+   MPI_File_set_size(fh, 0);
+   MPI_File_write_at_all(fh, (MPI_Offset) offset,
+                         const_cast<char *>(data.data()), (int) block_size,
+                         MPI_CHAR, MPI_STATUS_IGNORE);
+   MPI_File_close(&fh);
+
+   // The index is assembled and written by the root rank only.
+   vector<long long> all_info(myid == 0 ? num_procs * info.size() : 1);
+   MPI_Gather(&info[0], info.size(), MPI_LONG_LONG,
+              &all_info[0], info.size(), MPI_LONG_LONG, 0, comm);
+   if (myid == 0) { WriteIndex(name.str(), cycle, time, all_info); }
+}
+
+void AggregatedOutput::WriteIndex(const string &name, int cycle, double time,
+                                  const vector<long long> &all_info) const
+{
+   const int nsect = 1 + fields.size(), row_size = 2 + nsect;
+
+   ofstream index((name + ".index").c_str());
+   index << "# Laghos aggregated output index\n"
+         << "cycle " << cycle << "\n"
+         << "time " << setprecision(16) << time << "\n"
+         << "ranks " << num_procs << "\n"
+         << "files " << num_files << "\n"
+         << "sections mesh";
+   for (int f = 0; f < nsect - 1; f++) { index << " " << field_names[f]; }
+   index << "\n# rank file offset section_sizes\n";
+   for (int r = 0; r < num_procs; r++)
+   {
+      index << r;
+      for (int i = 0; i < row_size; i++)
+      {
+         index << " " << all_info[r * row_size + i];
+      }
+      index << "\n";
+   }
+}
+
+AggregatedOutput::~AggregatedOutput()
+{
+   MPI_Comm_free(&file_comm);
+}
+
+// Checkpoint file layout (all offsets in bytes):
+// - header: ckpt_header_ints long longs, followed by ckpt_header_reals doubles.
+// - directory: for every rank, the offset and size of its mesh block, and the
+//   index of its first zone record and the number of its records.
+// - zone records, ordered by rank and then by local zone index.
+// - timing states, ordered by rank.
+// - mesh blocks, ordered by rank.
+static const long long ckpt_magic = 0x4c4147484f53434bLL; // "LAGHOSCK"
+static const long long ckpt_version = 2;
+static const int ckpt_header_ints = 64, ckpt_header_reals = 64;
+static const MPI_Offset ckpt_dir_offset = 8 * (ckpt_header_ints +
+                                               ckpt_header_reals);
+static const int ckpt_dir_size = 4;
+
+static MPI_Offset CheckpointTableOffset(int np)
+{
+   return ckpt_dir_offset + 8 * (MPI_Offset) ckpt_dir_size * np;
+}
+
+static MPI_Offset CheckpointTimingOffset(int np, long long global_ne,
+                                         long long record_size)
+{
+   return CheckpointTableOffset(np) + 8 * (MPI_Offset) global_ne * record_size;
+}
+
+static MPI_Offset CheckpointMeshOffset(int np, long long global_ne,
+                                       long long record_size,
+                                       long long timing_size)
+{
+   return CheckpointTimingOffset(np, global_ne, record_size) +
+          8 * (MPI_Offset) np * timing_size;
+}
+
+static void CheckpointOpen(MPI_Comm comm, const string &name, int mode,
+                           MPI_File &fh)
+{
+   int err = MPI_File_open(comm, const_cast<char *>(name.c_str()), mode,
+                           MPI_INFO_NULL, &fh);
+   MFEM_VERIFY(err == MPI_SUCCESS, "Cannot open checkpoint file " << name);
+}
+
+void HydroCheckpoint::ZoneCentroid(const Vector &x0_loc, int dim, double *c)
+{
+   const int ndofs = x0_loc.Size() / dim;
+   for (int d = 0; d < dim; d++)
+   {
+      c[d] = 0.0;
+      for (int i = 0; i < ndofs; i++) { c[d] += x0_loc(d*ndofs + i); }
+      c[d] /= ndofs;
+   }
+}
+
+void HydroCheckpoint::Write(const char *file, const RunState &rs,
+                            ParFiniteElementSpace &H1FESpace,
+                            ParFiniteElementSpace &L2FESpace,
+                            const Vector &x0, const BlockVector &S,
+                            const Vector &timing)
+{
+   MPI_Comm comm = H1FESpace.GetComm();
+   int myid, np;
+   MPI_Comm_rank(comm, &myid);
+   MPI_Comm_size(comm, &np);
+
+   ParMesh *pmesh = H1FESpace.GetParMesh();
+   const int dim = pmesh->Dimension(), nzones = pmesh->GetNE(),
+             h1dofs_cnt = H1FESpace.GetFE(0)->GetDof(),
+             l2dofs_cnt = L2FESpace.GetFE(0)->GetDof();
+   const long long rec_size = RecordSize(dim, h1dofs_cnt, l2dofs_cnt),
+                   timing_size = timing.Size();
+
+   // Zone records.
+   vector<double> records(nzones * rec_size);
+   Array<int> h1dofs, l2dofs;
+   Vector x0_loc(dim * h1dofs_cnt), h1_loc(dim * h1dofs_cnt),
+          l2_loc(l2dofs_cnt);
+   for (int z = 0; z < nzones; z++)
+   {
+      double *r = &records[z * rec_size];
+      H1FESpace.GetElementVDofs(z, h1dofs);
+      L2FESpace.GetElementDofs(z, l2dofs);
+
+      x0.GetSubVector(h1dofs, x0_loc);
+      ZoneCentroid(x0_loc, dim, r);
+      r += dim;
+      for (int i = 0; i < x0_loc.Size(); i++) { r[i] = x0_loc(i); }
+      r += x0_loc.Size();
+      for (int b = 0; b < 2; b++)
+      {
+         S.GetBlock(b).GetSubVector(h1dofs, h1_loc);
+         for (int i = 0; i < h1_loc.Size(); i++) { r[i] = h1_loc(i); }
+         r += h1_loc.Size();
+      }
+      S.GetBlock(2).GetSubVector(l2dofs, l2_loc);
+      for (int i = 0; i < l2dofs_cnt; i++) { r[i] = l2_loc(i); }
+   }
+
+   // Local mesh in mfem's parallel mesh format.
+   ostringstream mesh_os;
+   mesh_os.precision(16);
+   pmesh->ParPrint(mesh_os);
+   const string mesh_str = mesh_os.str();
+   MFEM_VERIFY(mesh_str.size() <= INT_MAX, "The local mesh exceeds 2 GB.");
+
+   long long loc[2] = { (long long) nzones, (long long) mesh_str.size() },
+             first[2] = { 0, 0 }, global_ne = 0;
+   MPI_Exscan(loc, first, 2, MPI_LONG_LONG, MPI_SUM, comm);
+   if (myid == 0) { first[0] = first[1] = 0; }
+   MPI_Allreduce(&loc[0], &global_ne, 1, MPI_LONG_LONG, MPI_SUM, comm);
+
+   const MPI_Offset mesh_base =
+      CheckpointMeshOffset(np, global_ne, rec_size, timing_size);
+   long long dir[ckpt_dir_size] =
+   { (long long) mesh_base + first[1], loc[1], first[0], loc[0] };
+   vector<long long> all_dir(myid == 0 ? np * ckpt_dir_size : 1);
+   MPI_Gather(dir, ckpt_dir_size, MPI_LONG_LONG,
+              &all_dir[0], ckpt_dir_size, MPI_LONG_LONG, 0, comm);
+
+   // The checkpoint is first written to a temporary file, which replaces the
+   // old checkpoint only when it is complete.
+   const string name(file), tmp_name = name + ".tmp";
+   MPI_File fh;
+   CheckpointOpen(comm, tmp_name, MPI_MODE_CREATE | MPI_MODE_WRONLY, fh);
+   MPI_File_set_size(fh, 0);
+
+   if (myid == 0)
+   {
+      long long hi[ckpt_header_ints];
+      double hr[ckpt_header_reals];
+      for (int i = 0; i < ckpt_header_ints; i++) { hi[i] = 0; }
+      for (int i = 0; i < ckpt_header_reals; i++) { hr[i] = 0.0; }
+      hi[0] = ckpt_magic;   hi[1] = ckpt_version;
+      hi[2] = np;           hi[3] = dim;
+      hi[4] = rs.problem;   hi[5] = rs.order_v;
+      hi[6] = rs.order_e;   hi[7] = rs.ode_solver_type;
+      hi[8] = rs.ti;        hi[9] = rs.steps;
+      hi[10] = global_ne;   hi[11] = rec_size;
+      hi[12] = timing_size; hi[13] = rs.dt_control;
+      hr[0] = rs.t;         hr[1] = rs.dt;
+      hr[2] = rs.dt_control_state;
+      hr[3] = rs.gamma_value;   hr[4] = rs.energy_scale;
+      MPI_File_write_at(fh, 0, hi, ckpt_header_ints, MPI_LONG_LONG,
+                        MPI_STATUS_IGNORE);
+      MPI_File_write_at(fh, 8 * ckpt_header_ints, hr, ckpt_header_reals,
+                        MPI_DOUBLE, MPI_STATUS_IGNORE);
+      MPI_File_write_at(fh, ckpt_dir_offset, &all_dir[0], np * ckpt_dir_size,
+                        MPI_LONG_LONG, MPI_STATUS_IGNORE);
+   }
+
+   MPI_File_write_at_all(fh,
+                         CheckpointTableOffset(np) + 8 * first[0] * rec_size,
+                         records.size() ? &records[0] : NULL,
+                         (int) records.size(), MPI_DOUBLE, MPI_STATUS_IGNORE);
+   MPI_File_write_at_all(fh, CheckpointTimingOffset(np, global_ne, rec_size) +
+                         8 * (MPI_Offset) myid * timing_size,
+                         timing.GetData(), (int) timing_size, MPI_DOUBLE,
+                         MPI_STATUS_IGNORE);
+   MPI_File_write_at_all(fh, mesh_base + first[1],
+                         const_cast<char *>(mesh_str.data()),
+                         (int) mesh_str.size(), MPI_CHAR, MPI_STATUS_IGNORE);
+   MPI_File_close(&fh);
+
+   if (myid == 0)
+   {
+      MFEM_VERIFY(rename(tmp_name.c_str(), name.c_str()) == 0,
+                  "Cannot rename " << tmp_name << " to " << name);
+   }
+   MPI_Barrier(comm);
+}
+
+HydroCheckpoint::HydroCheckpoint(MPI_Comm comm_, const char *file)
+   : comm(comm_), file_name(file)
+{
+   MPI_Comm_rank(comm, &myid);
+   MPI_Comm_size(comm, &num_procs);
+
+   // The header is read by the root and broadcast to the other ranks.
+   long long hi[ckpt_header_ints];
+   double hr[ckpt_header_reals];
+   if (myid == 0)
+   {
+      MPI_File fh;
+      CheckpointOpen(MPI_COMM_SELF, file_name, MPI_MODE_RDONLY, fh);
+      MPI_File_read_at(fh, 0, hi, ckpt_header_ints, MPI_LONG_LONG,
+                       MPI_STATUS_IGNORE);
+      MPI_File_read_at(fh, 8 * ckpt_header_ints, hr, ckpt_header_reals,
+                       MPI_DOUBLE, MPI_STATUS_IGNORE);
+      MPI_File_close(&fh);
+   }
+   MPI_Bcast(hi, ckpt_header_ints, MPI_LONG_LONG, 0, comm);
+   MPI_Bcast(hr, ckpt_header_reals, MPI_DOUBLE, 0, comm);
+   MFEM_VERIFY(hi[0] == ckpt_magic,
+               file_name << " is not a Laghos checkpoint.");
+   MFEM_VERIFY(hi[1] == ckpt_version,
+               "Unsupported checkpoint version " << hi[1]);
+
+   file_num_procs = hi[2];         dim = hi[3];
+   state.problem = hi[4];          state.order_v = hi[5];
+   state.order_e = hi[6];          state.ode_solver_type = hi[7];
+   state.ti = hi[8];               state.steps = hi[9];
+   global_ne = hi[10];             record_size = hi[11];
+   timing_size = hi[12];           state.dt_control = hi[13];
+   state.t = hr[0];                state.dt = hr[1];
+   state.dt_control_state = hr[2];
+   state.gamma_value = hr[3];      state.energy_scale = hr[4];
+}
+
+ParMesh *HydroCheckpoint::ReadMesh() const
+{
+   MFEM_VERIFY(SameLayout(), "The checkpoint was written with "
+               << file_num_procs << " MPI tasks.");
+
+   MPI_File fh;
+   CheckpointOpen(comm, file_name, MPI_MODE_RDONLY, fh);
+   long long dir[ckpt_dir_size];
+   MPI_File_read_at_all(fh, ckpt_dir_offset + 8 * ckpt_dir_size * myid, dir,
+                        ckpt_dir_size, MPI_LONG_LONG, MPI_STATUS_IGNORE);
+   string mesh_str(dir[1], ' ');
+   MPI_File_read_at_all(fh, dir[0], &mesh_str[0], (int) dir[1], MPI_CHAR,
+                        MPI_STATUS_IGNORE);
+   MPI_File_close(&fh);
+
+   istringstream mesh_is(mesh_str);
+   return new ParMesh(comm, mesh_is);
+}
+
+// Lexicographic ordering of zone records by their quantized centroids.
+struct CentroidLess
+{
+   const vector<long long> &keys;
+   const int dim;
+   CentroidLess(const vector<long long> &k, int d) : keys(k), dim(d) { }
+   bool operator()(int a, int b) const
+   {
+      return lexicographical_compare(&keys[a*dim], &keys[a*dim] + dim,
+                                     &keys[b*dim], &keys[b*dim] + dim);
+   }
+};
+
+template <typename T>
+static inline T *VectorData(vector<T> &v) { return v.empty() ? NULL : &v[0]; }
+
+// Rank that matches the zone records and the zones with the given centroid
+// key during a repartitioned restart.
+static int KeyRank(const long long *key, int dim, int np)
+{
+   unsigned long long h = 14695981039346656037ULL;
+   for (int d = 0; d < dim; d++)
+   {
+      h = (h ^ (unsigned long long) key[d]) * 1099511628211ULL;
+   }
+   return (int) (h % (unsigned long long) np);
+}
+
+// Sends item i of items, made of n values, to rank dest[i]. The received items
+// are ordered by source rank; items from the same rank keep their order.
+// Collective.
+template <typename T>
+static void ExchangeItems(MPI_Comm comm, MPI_Datatype type, int n,
+                          const vector<int> &dest, const vector<T> &items,
+                          vector<T> &received)
+{
+   int np;
+   MPI_Comm_size(comm, &np);
+   MFEM_VERIFY((long long) dest.size() * n <= INT_MAX,
+               "The checkpoint data sent by a rank exceeds 2^31 values, "
+               "increase the number of MPI tasks.");
+   vector<int> scount(np, 0), rcount(np), sdispl(np, 0), rdispl(np, 0);
+   for (size_t i = 0; i < dest.size(); i++) { scount[dest[i]] += n; }
+   MPI_Alltoall(&scount[0], 1, MPI_INT, &rcount[0], 1, MPI_INT, comm);
+   long long rsize = 0;
+   for (int p = 0; p < np; p++) { rsize += rcount[p]; }
+   MFEM_VERIFY(rsize <= INT_MAX,
+               "The checkpoint data received by a rank exceeds 2^31 values, "
+               "increase the number of MPI tasks.");
+   for (int p = 1; p < np; p++)
+   {
+      sdispl[p] = sdispl[p-1] + scount[p-1];
+      rdispl[p] = rdispl[p-1] + rcount[p-1];
+   }
+
+   vector<T> sbuf(dest.size() * n);
+   vector<int> pos(sdispl);
+   for (size_t i = 0; i < dest.size(); i++)
+   {
+      copy(&items[i*n], &items[i*n] + n, &sbuf[pos[dest[i]]]);
+      pos[dest[i]] += n;
+   }
+   received.resize(rsize);
+   MPI_Alltoallv(VectorData(sbuf), &scount[0], &sdispl[0], type,
+                 VectorData(received), &rcount[0], &rdispl[0], type, comm);
+}
+
+void HydroCheckpoint::ReadState(ParFiniteElementSpace &H1FESpace,
+                                ParFiniteElementSpace &L2FESpace,
+                                Vector &x0, BlockVector &S) const
+{
+   const int nzones = H1FESpace.GetNE(),
+             h1dofs_cnt = H1FESpace.GetFE(0)->GetDof(),
+             l2dofs_cnt = L2FESpace.GetFE(0)->GetDof();
+   MFEM_VERIFY(H1FESpace.GetMesh()->Dimension() == dim &&
+               RecordSize(dim, h1dofs_cnt, l2dofs_cnt) == record_size,
+               "The checkpoint does not match the finite element spaces.");
+   MFEM_VERIFY(nzones * record_size <= INT_MAX,
+               "The local zone records exceed 2^31 values, increase the "
+               "number of MPI tasks.");
+
+   MPI_File fh;
+   CheckpointOpen(comm, file_name, MPI_MODE_RDONLY, fh);
+   const MPI_Offset table = CheckpointTableOffset(file_num_procs);
+
+   // zone_rec[z] is the position of the record of local zone z in records.
+   vector<double> records;
+   vector<int> zone_rec(nzones);
+   if (SameLayout())
+   {
+      long long dir[ckpt_dir_size];
+      MPI_File_read_at_all(fh, ckpt_dir_offset + 8 * ckpt_dir_size * myid, dir,
+                           ckpt_dir_size, MPI_LONG_LONG, MPI_STATUS_IGNORE);
+      MFEM_VERIFY(dir[3] == nzones, "Wrong number of zones in the checkpoint.");
+      records.resize(nzones * record_size);
+      MPI_File_read_at_all(fh, table + 8 * dir[2] * record_size,
+                           VectorData(records), (int) records.size(),
+                           MPI_DOUBLE, MPI_STATUS_IGNORE);
+      for (int z = 0; z < nzones; z++) { zone_rec[z] = z; }
+   }
+   else
+   {
+      // Every rank reads a contiguous slice of the zone table. The records and
+      // the local zones meet on the rank given by the key of their initial
+      // centroid, which sends the records on to the owners of the zones.
+      const long long first = global_ne * myid / num_procs,
+                      last = global_ne * (myid + 1) / num_procs;
+      MFEM_VERIFY((last - first) * record_size <= INT_MAX,
+                  "The checkpoint table slice of a rank exceeds 2^31 values, "
+                  "increase the number of MPI tasks.");
+      const int nslice = (int) (last - first);
+      vector<double> slice(nslice * record_size);
+      MPI_File_read_at_all(fh, table + 8 * first * record_size,
+                           VectorData(slice), (int) slice.size(), MPI_DOUBLE,
+                           MPI_STATUS_IGNORE);
+
+      // Quantize the centroids relative to the domain extent, so that they can
+      // be compared exactly.
+      Vector loc_min(dim), loc_max(dim), cmin(dim), cmax(dim);
+      loc_min = numeric_limits<double>::infinity();
+      loc_max = -numeric_limits<double>::infinity();
+      for (int r = 0; r < nslice; r++)
+      {
+         for (int d = 0; d < dim; d++)
+         {
+            loc_min(d) = min(loc_min(d), slice[r * record_size + d]);
+            loc_max(d) = max(loc_max(d), slice[r * record_size + d]);
+         }
+      }
+      MPI_Allreduce(loc_min.GetData(), cmin.GetData(), dim, MPI_DOUBLE,
+                    MPI_MIN, comm);
+      MPI_Allreduce(loc_max.GetData(), cmax.GetData(), dim, MPI_DOUBLE,
+                    MPI_MAX, comm);
+      double extent = 0.0;
+      for (int d = 0; d < dim; d++) { extent = max(extent, cmax(d) - cmin(d)); }
+      const double h = 1e-9 * max(extent, 1e-300);
+
+      // Send the records of the slice to their matching ranks.
+      vector<long long> keys(nslice * dim);
+      vector<int> dest(nslice);
+      for (int r = 0; r < nslice; r++)
+      {
+         for (int d = 0; d < dim; d++)
+         {
+            keys[r*dim + d] =
+               llround((slice[r*record_size + d] - cmin(d)) / h);
+         }
+         dest[r] = KeyRank(&keys[r*dim], dim, num_procs);
+      }
+      vector<long long> rec_keys;
+      vector<double> rec_data;
+      ExchangeItems(comm, MPI_LONG_LONG, dim, dest, keys, rec_keys);
+      ExchangeItems(comm, MPI_DOUBLE, (int) record_size, dest, slice,
+                    rec_data);
+      vector<double>().swap(slice);
+
+      // Requests for the records of the local zones: the centroid key, the
+      // rank and the zone. The position block of S holds the initial mesh
+      // positions.
+      const int req_size = dim + 2;
+      vector<long long> req(nzones * req_size), rec_req;
+      Array<int> h1dofs;
+      Vector x0_loc(dim * h1dofs_cnt);
+      double c[3];
+      dest.resize(nzones);
+      for (int z = 0; z < nzones; z++)
+      {
+         H1FESpace.GetElementVDofs(z, h1dofs);
+         S.GetBlock(0).GetSubVector(h1dofs, x0_loc);
+         ZoneCentroid(x0_loc, dim, c);
+         long long *q = &req[z * req_size];
+         for (int d = 0; d < dim; d++) { q[d] = llround((c[d] - cmin(d)) / h); }
+         q[dim] = myid;
+         q[dim + 1] = z;
+         dest[z] = KeyRank(q, dim, num_procs);
+      }
+      ExchangeItems(comm, MPI_LONG_LONG, req_size, dest, req, rec_req);
+
+      // Match the requests with the received records. The key of a request is
+      // appended to rec_keys temporarily, to search for it with CentroidLess.
+      const int nrec = rec_keys.size() / dim,
+                nreq = rec_req.size() / req_size;
+      vector<int> order(nrec);
+      for (int i = 0; i < nrec; i++) { order[i] = i; }
+      sort(order.begin(), order.end(), CentroidLess(rec_keys, dim));
+      vector<long long> reply_zone(nreq), zones;
+      vector<double> reply(nreq * record_size);
+      dest.resize(nreq);
+      for (int i = 0; i < nreq; i++)
+      {
+         const long long *q = &rec_req[i * req_size];
+         rec_keys.insert(rec_keys.end(), q, q + dim);
+         vector<int>::iterator it = lower_bound(order.begin(), order.end(),
+                                                nrec,
+                                                CentroidLess(rec_keys, dim));
+         MFEM_VERIFY(it != order.end() &&
+                     equal(q, q + dim, &rec_keys[(*it)*dim]),
+                     "Zone " << q[dim + 1] << " of rank " << q[dim]
+                     << " was not found in the checkpoint.");
+         rec_keys.resize(nrec * dim);
+         copy(&rec_data[(*it) * record_size],
+              &rec_data[(*it) * record_size] + record_size,
+              &reply[i * record_size]);
+         reply_zone[i] = q[dim + 1];
+         dest[i] = (int) q[dim];
+      }
+      ExchangeItems(comm, MPI_LONG_LONG, 1, dest, reply_zone, zones);
+      ExchangeItems(comm, MPI_DOUBLE, (int) record_size, dest, reply, records);
+      MFEM_VERIFY((int) zones.size() == nzones,
+                  "Wrong number of zone records received.");
+      for (int i = 0; i < nzones; i++) { zone_rec[zones[i]] = i; }
+
+      // The records must describe the same initial zones.
+      for (int z = 0; z < nzones; z++)
+      {
+         H1FESpace.GetElementVDofs(z, h1dofs);
+         S.GetBlock(0).GetSubVector(h1dofs, x0_loc);
+         const double *r0 = &records[zone_rec[z] * record_size + dim];
+         for (int i = 0; i < x0_loc.Size(); i++)
+         {
+            MFEM_VERIFY(fabs(r0[i] - x0_loc(i)) <= 1e3 * h,
+                        "Mismatch in the initial positions of zone " << z
+                        << "; the mesh must be refined as in the original "
+                        << "run.");
+         }
+      }
+   }
+   MPI_File_close(&fh);
+
+   x0.SetSize(H1FESpace.GetVSize());
+   Array<int> h1dofs, l2dofs;
+   for (int z = 0; z < nzones; z++)
+   {
+      const double *r = &records[zone_rec[z] * record_size] + dim;
+      H1FESpace.GetElementVDofs(z, h1dofs);
+      L2FESpace.GetElementDofs(z, l2dofs);
+      const int nh = h1dofs.Size();
+      for (int i = 0; i < nh; i++) { x0(h1dofs[i]) = r[i]; }
+      r += nh;
+      for (int b = 0; b < 2; b++)
+      {
+         Vector &blk = S.GetBlock(b);
+         for (int i = 0; i < nh; i++) { blk(h1dofs[i]) = r[i]; }
+         r += nh;
+      }
+      Vector &e = S.GetBlock(2);
+      for (int i = 0; i < l2dofs.Size(); i++) { e(l2dofs[i]) = r[i]; }
+   }
+}
+
+void HydroCheckpoint::ReadTiming(DenseMatrix &timing) const
+{
+   timing.SetSize(timing_size, file_num_procs);
+   MPI_File fh;
+   CheckpointOpen(comm, file_name, MPI_MODE_RDONLY, fh);
+   MPI_File_read_at_all(fh, CheckpointTimingOffset(file_num_procs, global_ne,
+                                                   record_size),
+                        timing.Data(), timing_size * file_num_procs,
+                        MPI_DOUBLE, MPI_STATUS_IGNORE);
+   MPI_File_close(&fh);
+}
+
+JSONWriter::JSONWriter(ostream &out_) : out(out_)
+{
+   out.precision(12);
+}
+
+void JSONWriter::Key(const char *key)
+{
+   if (!first.empty())
+   {
+      if (!first.back()) { out << ','; }
+      first.back() = false;
+      out << '\n' << string(3 * first.size(), ' ');
+   }
+   if (key) { String(key); out << ": "; }
+}
+
+void JSONWriter::String(const char *str)
+{
+   out << '"';
+   for (const char *c = str; *c; c++)
+   {
+      switch (*c)
+      {
+         case '"': out << "\\\""; break;
+         case '\\': out << "\\\\"; break;
+         case '\n': out << "\\n"; break;
+         case '\t': out << "\\t"; break;
+         default:
+            if ((unsigned char) *c < 0x20)
+            {
+               char buf[8];
+               snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char) *c);
+               out << buf;
+            }
+            else { out << *c; }
+      }
+   }
+   out << '"';
+}
+
+void JSONWriter::BeginObject(const char *key)
+{
+   Key(key);
+   out << '{';
+   first.push_back(true);
+}
+
+void JSONWriter::EndObject()
+{
+   const bool empty = first.back();
+   first.pop_back();
+   if (!empty) { out << '\n' << string(3 * first.size(), ' '); }
+   out << '}';
+   if (first.empty()) { out << endl; }
+}
+
+void JSONWriter::BeginArray(const char *key)
+{
+   Key(key);
+   out << '[';
+   first.push_back(true);
+}
+
+void JSONWriter::EndArray()
+{
+   const bool empty = first.back();
+   first.pop_back();
+   if (!empty) { out << '\n' << string(3 * first.size(), ' '); }
+   out << ']';
+}
+
+void JSONWriter::Add(const char *key, double value)
+{
+   Key(key);
+   if (value - value == 0.0) { out << value; }
+   else { out << "null"; }
+}
+
+void JSONWriter::Add(const char *key, int value)
+{
+   Key(key);
+   out << value;
+}
+
+void JSONWriter::Add(const char *key, long long value)
+{
+   Key(key);
+   out << value;
+}
+
+void JSONWriter::Add(const char *key, bool value)
+{
+   Key(key);
+   out << (value ? "true" : "false");
+}
+
+void JSONWriter::Add(const char *key, const char *value)
+{
+   Key(key);
+   String(value);
+}
+
+} // namespace hydrodynamics
+
+} // namespace mfem
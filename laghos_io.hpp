@@ -0,0 +1,177 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_IO
+#define MFEM_LAGHOS_IO
+
+#include "laghos_compat.hpp"
+
+#include <string>
+#include <vector>
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// Writes the mesh and the registered fields of all MPI ranks into a fixed
+// number of shared files, using collective MPI-IO writes. The ranks are split
+// into contiguous groups, one group per file. Each rank contributes a block
+// that contains its mesh, followed by its fields, in the same text format as
+// the per-rank files of the -print option. A small text index, written by the
+// root rank, records the file and byte offset of every (rank, section) pair,
+// so that the per-rank pieces can be extracted without scanning the data.
+//
+// The output of one dump is:
+//    <prefix>_<cycle>.index
+//    <prefix>_<cycle>.data.000000, ..., <prefix>_<cycle>.data.<nfiles-1>
+class AggregatedOutput
+{
+private:
+   MPI_Comm comm, file_comm;
+   int myid, num_procs, num_files, file_id;
+
+   ParMesh &pmesh;
+   std::vector<std::string> field_names;
+   std::vector<ParGridFunction *> fields;
+
+   // Writes the index of a dump; called only by the root rank.
+   void WriteIndex(const std::string &name, int cycle, double time,
+                   const std::vector<long long> &all_info) const;
+
+public:
+   AggregatedOutput(ParMesh &pmesh_, int nfiles);
+
+   void RegisterField(const char *name, ParGridFunction *gf);
+
+   // Collective over the mesh communicator.
+   void Save(const char *prefix, int cycle, double time);
+
+   int GetNumFiles() const { return num_files; }
+
+   ~AggregatedOutput();
+};
+
+// Binary checkpoint of the full hydro state. The file contains a header with
+// the run state (time, time step, step counters and the discretization
+// parameters), the local parallel meshes, a table with one fixed-size record
+// per zone, and the timing state of every rank.
+//
+// Each zone record stores the zone's initial and current positions, its
+// velocity and its specific internal energy in the element-local dof ordering,
+// together with the centroid of its initial position dofs. Restarts on the
+// same number of MPI tasks read back the local meshes and records directly.
+// Restarts on a different number of tasks rebuild the mesh in the usual way
+// and locate the records of their zones by the initial centroids, which do not
+// depend on the parallel partitioning. Each rank then reads only a slice of the
+// record table, and the records are routed to the ranks that own their zones.
+class HydroCheckpoint
+{
+public:
+   // Run state stored in the header.
+   struct RunState
+   {
+      int problem, order_v, order_e, ode_solver_type;
+      int ti, steps;
+      double t, dt;
+      // The -dtc choice and the TimeStepController state.
+      int dt_control;
+      double dt_control_state;
+      // The problem parameters, see ProblemSetup.
+      double gamma_value, energy_scale;
+   };
+
+private:
+   MPI_Comm comm;
+   int myid, num_procs;
+   std::string file_name;
+
+   // Header data of an opened checkpoint.
+   RunState state;
+   int file_num_procs, dim;
+   long long global_ne, record_size, timing_size;
+
+   static long long RecordSize(int dim, int h1dofs_cnt, int l2dofs_cnt)
+   { return dim + 3 * dim * h1dofs_cnt + l2dofs_cnt; }
+
+   static void ZoneCentroid(const Vector &x0_loc, int dim, double *c);
+
+public:
+   // Opens an existing checkpoint and reads its header. Collective.
+   HydroCheckpoint(MPI_Comm comm_, const char *file);
+
+   // Writes a checkpoint. The vector x0 contains the initial mesh positions and
+   // timing contains the timing state of the local rank. Collective.
+   static void Write(const char *file, const RunState &rs,
+                     ParFiniteElementSpace &H1FESpace,
+                     ParFiniteElementSpace &L2FESpace,
+                     const Vector &x0, const BlockVector &S,
+                     const Vector &timing);
+
+   const RunState &GetRunState() const { return state; }
+
+   // True when the checkpoint was written with the current number of tasks.
+   bool SameLayout() const { return file_num_procs == num_procs; }
+   int GetNumProcs() const { return file_num_procs; }
+
+   // Reads back the local parallel mesh; requires SameLayout().
+   ParMesh *ReadMesh() const;
+
+   // Fills the initial positions x0 and the state S. Collective.
+   void ReadState(ParFiniteElementSpace &H1FESpace,
+                  ParFiniteElementSpace &L2FESpace,
+                  Vector &x0, BlockVector &S) const;
+
+   // Timing states of all ranks that wrote the checkpoint, one per column.
+   void ReadTiming(DenseMatrix &timing) const;
+};
+
+// Writes a JSON document made of nested objects and arrays with number,
+// string and boolean members, one member per line. Non-finite numbers are
+// written as null. Members of arrays are added with a NULL key.
+class JSONWriter
+{
+private:
+   std::ostream &out;
+   // One entry per open object or array: true until its first member.
+   std::vector<bool> first;
+
+   void Key(const char *key);
+   void String(const char *str);
+
+public:
+   JSONWriter(std::ostream &out_);
+
+   void BeginObject(const char *key = NULL);
+   void EndObject();
+   void BeginArray(const char *key);
+   void EndArray();
+
+   void Add(const char *key, double value);
+   void Add(const char *key, int value);
+   void Add(const char *key, long long value);
+   void Add(const char *key, bool value);
+   void Add(const char *key, const char *value);
+   void Add(const char *key, const std::string &value)
+   { Add(key, value.c_str()); }
+};
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_LAGHOS_IO
@@ -0,0 +1,486 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#include "laghos_mesh.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <map>
+#include <sstream>
+
+using namespace std;
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// Corners of the reference square / cube in MFEM's vertex ordering.
+static const int box_corners[8][3] =
+{
+   {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+   {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}
+};
+
+int CartesianMeshGenerator::CoordIndex(int d, double x) const
+{
+   const vector<double> &c = coord[d];
+   const double tol = 1e-10 * (c.back() - c.front());
+   const int i = lower_bound(c.begin(), c.end(), x - tol) - c.begin();
+   if (i == (int) c.size() || c[i] > x + tol) { return -1; }
+   return i;
+}
+
+bool CartesianMeshGenerator::GetBox(const Mesh &mesh, const Array<int> &v,
+                                    int *lo, int *hi, int &corners) const
+{
+   int ijk[8][3];
+   for (int d = 0; d < dim; d++) { lo[d] = INT_MAX; hi[d] = -1; }
+   for (int i = 0; i < v.Size(); i++)
+   {
+      const double *x = mesh.GetVertex(v[i]);
+      for (int d = 0; d < dim; d++)
+      {
+         ijk[i][d] = CoordIndex(d, x[d]);
+         if (ijk[i][d] < 0) { return false; }
+         lo[d] = min(lo[d], ijk[i][d]);
+         hi[d] = max(hi[d], ijk[i][d]);
+      }
+   }
+   corners = 0;
+   for (int i = 0; i < v.Size(); i++)
+   {
+      int c = 0;
+      for (int d = 0; d < dim; d++) { c |= (ijk[i][d] - lo[d]) << d; }
+      corners |= 1 << c;
+   }
+   return true;
+}
+
+bool CartesianMeshGenerator::Init(const Mesh &mesh)
+{
+   dim = mesh.Dimension();
+   levels = 0;
+   if (dim < 2 || dim > 3 || mesh.SpaceDimension() != dim) { return false; }
+
+   // Distinct vertex coordinates in each direction.
+   const int nv = mesh.GetNV(), ne = mesh.GetNE(), nbe = mesh.GetNBE();
+   for (int d = 0; d < dim; d++)
+   {
+      vector<double> &c = coord[d];
+      c.resize(nv);
+      for (int v = 0; v < nv; v++) { c[v] = mesh.GetVertex(v)[d]; }
+      sort(c.begin(), c.end());
+      const double tol = 1e-10 * (c.back() - c.front());
+      if (!(tol > 0.0)) { return false; }
+      int n = 1;
+      for (int v = 1; v < nv; v++)
+      {
+         if (c[v] - c[n-1] > tol) { c[n++] = c[v]; }
+      }
+      c.resize(n);
+   }
+   if (dim == 2) { coord[2].assign(1, 0.0); }
+   coarse_nz[2] = 1;
+
+   // A tensor-product grid has these numbers of vertices, zones and boundary
+   // faces. Together with the checks below, this excludes holes and overlaps.
+   int nv_grid = 1, ne_grid = 1, nbe_grid = 0;
+   for (int d = 0; d < dim; d++) { coarse_nz[d] = NumZones(d); }
+   for (int d = 0; d < dim; d++)
+   {
+      nv_grid *= coarse_nz[d] + 1;
+      ne_grid *= coarse_nz[d];
+      int side = 1;
+      for (int t = 0; t < dim; t++) { if (t != d) { side *= coarse_nz[t]; } }
+      nbe_grid += 2 * side;
+   }
+   if (nv != nv_grid || ne != ne_grid || nbe != nbe_grid) { return false; }
+
+   // Every zone must fill one cell of the grid.
+   const int geom = (dim == 2) ? Geometry::SQUARE : Geometry::CUBE;
+   const int all_corners = (1 << (1 << dim)) - 1;
+   int lo[3], hi[3], corners;
+   Array<int> v;
+   coarse_attr.assign(ne, 0);
+   for (int e = 0; e < ne; e++)
+   {
+      if (mesh.GetElementBaseGeometry(e) != geom) { return false; }
+      mesh.GetElementVertices(e, v);
+      if (!GetBox(mesh, v, lo, hi, corners)) { return false; }
+      int z = 0;
+      for (int d = dim - 1; d >= 0; d--)
+      {
+         if (hi[d] != lo[d] + 1) { return false; }
+         z = z * coarse_nz[d] + lo[d];
+      }
+      if (corners != all_corners || coarse_attr[z] != 0) { return false; }
+      coarse_attr[z] = mesh.GetAttribute(e);
+   }
+
+   // Every boundary face must be on the outer box, with one attribute per side.
+   const int bgeom = (dim == 2) ? Geometry::SEGMENT : Geometry::SQUARE;
+   for (int d = 0; d < 3; d++) { bdr_attr[d][0] = bdr_attr[d][1] = 0; }
+   for (int be = 0; be < nbe; be++)
+   {
+      if (mesh.GetBdrElementBaseGeometry(be) != bgeom) { return false; }
+      mesh.GetBdrElementVertices(be, v);
+      if (!GetBox(mesh, v, lo, hi, corners)) { return false; }
+      int normal = -1;
+      for (int d = 0; d < dim; d++)
+      {
+         if (hi[d] == lo[d])
+         {
+            if (normal >= 0) { return false; }
+            normal = d;
+         }
+         else if (hi[d] != lo[d] + 1) { return false; }
+      }
+      if (normal < 0) { return false; }
+      int side;
+      if (lo[normal] == 0) { side = 0; }
+      else if (lo[normal] == coarse_nz[normal]) { side = 1; }
+      else { return false; }
+      int &attr = bdr_attr[normal][side];
+      if (attr == 0) { attr = mesh.GetBdrAttribute(be); }
+      else if (attr != mesh.GetBdrAttribute(be)) { return false; }
+   }
+   for (int d = 0; d < dim; d++)
+   {
+      if (bdr_attr[d][0] == 0 || bdr_attr[d][1] == 0) { return false; }
+   }
+   return true;
+}
+
+void CartesianMeshGenerator::Refine(int ref_levels)
+{
+   for (int l = 0; l < ref_levels; l++)
+   {
+      for (int d = 0; d < dim; d++)
+      {
+         const vector<double> c(coord[d]);
+         const int n = (int) c.size() - 1;
+         coord[d].resize(2 * n + 1);
+         for (int i = 0; i < n; i++)
+         {
+            coord[d][2*i]   = c[i];
+            coord[d][2*i+1] = 0.5 * (c[i] + c[i+1]);
+         }
+         coord[d][2*n] = c[n];
+      }
+   }
+   levels += ref_levels;
+}
+
+// Tasks that own the zones around the grid entity with lowest vertex g, which
+// spans one cell in the directions of ext_mask. Returns their number; the list
+// is sorted.
+static int EntityTasks(int dim, const vector<int> *part, const int *np,
+                       const int *g, int ext_mask, int *tasks)
+{
+   int tp[3][2], tn[3];
+   for (int d = 0; d < 3; d++)
+   {
+      tn[d] = 0;
+      if (d >= dim) { tp[d][tn[d]++] = 0; continue; }
+      const int n = (int) part[d].size();
+      if (ext_mask & (1 << d)) { tp[d][tn[d]++] = part[d][g[d]]; continue; }
+      if (g[d] > 0) { tp[d][tn[d]++] = part[d][g[d]-1]; }
+      if (g[d] < n && (tn[d] == 0 || part[d][g[d]] != tp[d][0]))
+      {
+         tp[d][tn[d]++] = part[d][g[d]];
+      }
+   }
+   int cnt = 0;
+   for (int k = 0; k < tn[2]; k++)
+      for (int j = 0; j < tn[1]; j++)
+         for (int i = 0; i < tn[0]; i++)
+         {
+            tasks[cnt++] = tp[0][i] + np[0] * (tp[1][j] + np[1] * tp[2][k]);
+         }
+   sort(tasks, tasks + cnt);
+   return cnt;
+}
+
+// Local index of the grid vertex g.
+static inline int LocalVertex(const int *g, const int *first, const int *nlv)
+{
+   return (g[0] - first[0]) + nlv[0] * ((g[1] - first[1]) +
+                                        nlv[1] * (g[2] - first[2]));
+}
+
+ParMesh *CartesianMeshGenerator::MakeParMesh(MPI_Comm comm,
+                                             const int *nxyz) const
+{
+   int myid;
+   MPI_Comm_rank(comm, &myid);
+
+   // Task of each zone layer, determined by the zone centers in the same way as
+   // in Mesh::CartesianPartitioning(), and the zone range of the local task.
+   // The vertices of the local task are first[d] <= g[d] <= last[d].
+   int np[3] = {1, 1, 1}, first[3] = {0, 0, 0}, last[3] = {0, 0, 0};
+   vector<int> part[3];
+   int r = myid;
+   for (int d = 0; d < dim; d++)
+   {
+      np[d] = nxyz[d];
+      const vector<double> &c = coord[d];
+      const int n = NumZones(d);
+      vector<int> count(np[d], 0);
+      part[d].resize(n);
+      for (int i = 0; i < n; i++)
+      {
+         const double x = 0.5 * (c[i] + c[i+1]);
+         int idx = (int) floor(np[d] * (x - c.front()) /
+                               (c.back() - c.front()));
+         idx = max(0, min(idx, np[d] - 1));
+         part[d][i] = idx;
+         count[idx]++;
+      }
+      for (int k = 0; k < np[d]; k++) { if (count[k] == 0) { return NULL; } }
+      const int p = r % np[d];
+      r /= np[d];
+      first[d] = (int) (find(part[d].begin(), part[d].end(), p) -
+                        part[d].begin());
+      last[d] = first[d] + count[p];
+   }
+   int nlv[3];
+   for (int d = 0; d < 3; d++) { nlv[d] = last[d] - first[d] + 1; }
+   const int nzk = (dim == 3) ? last[2] : 1;
+
+   // Zones.
+   const int geom = (dim == 2) ? Geometry::SQUARE : Geometry::CUBE;
+   const int nzv = 1 << dim;
+   ostringstream elements;
+   int ne = 0, g[3];
+   for (int k = first[2]; k < nzk; k++)
+      for (int j = first[1]; j < last[1]; j++)
+         for (int i = first[0]; i < last[0]; i++)
+         {
+            const int cz = (i >> levels) + coarse_nz[0] *
+                           ((j >> levels) + coarse_nz[1] * (k >> levels));
+            elements << coarse_attr[cz] << ' ' << geom;
+            for (int c = 0; c < nzv; c++)
+            {
+               g[0] = i + box_corners[c][0];
+               g[1] = j + box_corners[c][1];
+               g[2] = k + box_corners[c][2];
+               elements << ' ' << LocalVertex(g, first, nlv);
+            }
+            elements << '\n';
+            ne++;
+         }
+
+   // Boundary faces on the sides of the box, oriented with outward normals.
+   const int bgeom = (dim == 2) ? Geometry::SEGMENT : Geometry::SQUARE;
+   ostringstream boundary;
+   int nbe = 0;
+   for (int d = 0; d < dim; d++)
+   {
+      for (int s = 0; s < 2; s++)
+      {
+         if ((s == 0 && first[d] > 0) || (s == 1 && last[d] < NumZones(d)))
+         {
+            continue;
+         }
+         const int a = (d + 1) % dim, b = (d + 2) % dim;
+         g[2] = 0;
+         g[d] = (s == 0) ? 0 : last[d];
+         const int nb = (dim == 3) ? last[b] : first[b] + 1;
+         for (int jb = first[b]; jb < nb; jb++)
+            for (int ja = first[a]; ja < last[a]; ja++)
+            {
+               boundary << bdr_attr[d][s] << ' ' << bgeom;
+               if (dim == 2)
+               {
+                  const bool up = (d + s == 1);
+                  g[a] = up ? ja : ja + 1;
+                  boundary << ' ' << LocalVertex(g, first, nlv);
+                  g[a] = up ? ja + 1 : ja;
+                  boundary << ' ' << LocalVertex(g, first, nlv);
+               }
+               else
+               {
+                  for (int c = 0; c < 4; c++)
+                  {
+                     const int cc = (s == 1) ? c : (4 - c) % 4;
+                     g[a] = ja + box_corners[cc][0];
+                     g[b] = jb + box_corners[cc][1];
+                     boundary << ' ' << LocalVertex(g, first, nlv);
+                  }
+               }
+               boundary << '\n';
+               nbe++;
+            }
+      }
+   }
+
+   // Shared vertices (ext_mask 0), edges (one bit) and faces (two bits). Each
+   // entity goes to the group of tasks around it. All tasks of a group list
+   // the entities in the same order: by type, then lexicographically.
+   map<vector<int>, int> group_ids;
+   vector<vector<int> > groups(1, vector<int>(1, myid));
+   group_ids[groups[0]] = 0;
+   vector<vector<int> > shared[3];
+   for (int s = 0; s < 3; s++) { shared[s].resize(1); }
+   int num_shared[3] = {0, 0, 0}, tasks[8];
+   for (int t = 0; t < dim; t++)
+   {
+      const int num_masks = (t == 0) ? 1 : dim;
+      for (int m = 0; m < num_masks; m++)
+      {
+         int ext_mask = 0, dirs[2];
+         if (t == 1) { ext_mask = 1 << m; dirs[0] = m; }
+         if (t == 2)
+         {
+            dirs[0] = (m + 1) % 3; dirs[1] = (m + 2) % 3;
+            ext_mask = (1 << dirs[0]) | (1 << dirs[1]);
+         }
+         int end[3];
+         for (int d = 0; d < 3; d++)
+         {
+            end[d] = last[d] - ((ext_mask >> d) & 1);
+         }
+         for (g[2] = first[2]; g[2] <= end[2]; g[2]++)
+            for (g[1] = first[1]; g[1] <= end[1]; g[1]++)
+               for (g[0] = first[0]; g[0] <= end[0]; g[0]++)
+               {
+                  const int cnt =
+                     EntityTasks(dim, part, np, g, ext_mask, tasks);
+                  if (cnt == 1) { continue; }
+                  vector<int> key(tasks, tasks + cnt);
+                  map<vector<int>, int>::iterator it = group_ids.find(key);
+                  int gr;
+                  if (it != group_ids.end()) { gr = it->second; }
+                  else
+                  {
+                     gr = (int) groups.size();
+                     group_ids[key] = gr;
+                     groups.push_back(key);
+                     for (int s = 0; s < 3; s++) { shared[s].resize(gr + 1); }
+                  }
+                  vector<int> &list = shared[t][gr];
+                  const int nev = 1 << t;
+                  for (int c = 0; c < nev; c++)
+                  {
+                     int gv[3] = {g[0], g[1], g[2]};
+                     if (t == 1) { gv[dirs[0]] += c; }
+                     if (t == 2)
+                     {
+                        gv[dirs[0]] += box_corners[c][0];
+                        gv[dirs[1]] += box_corners[c][1];
+                     }
+                     list.push_back(LocalVertex(gv, first, nlv));
+                  }
+                  num_shared[t]++;
+               }
+      }
+   }
+
+   // Local mesh in the format of ParMesh::ParPrint(). Without MPI, the only
+   // task has the whole mesh, written in the serial format.
+   ostringstream os;
+   os.precision(17);
+#ifdef MFEM_USE_MPI
+   os << "MFEM mesh v1.2\n";
+#else
+   os << "MFEM mesh v1.0\n";
+#endif
+   os << "\ndimension\n" << dim
+      << "\n\nelements\n" << ne << '\n' << elements.str()
+      << "\nboundary\n" << nbe << '\n' << boundary.str()
+      << "\nvertices\n" << nlv[0] * nlv[1] * nlv[2] << '\n' << dim << '\n';
+   for (g[2] = first[2]; g[2] <= last[2]; g[2]++)
+      for (g[1] = first[1]; g[1] <= last[1]; g[1]++)
+         for (g[0] = first[0]; g[0] <= last[0]; g[0]++)
+         {
+            for (int d = 0; d < dim; d++)
+            {
+               os << coord[d][g[d]] << ((d == dim - 1) ? '\n' : ' ');
+            }
+         }
+#ifdef MFEM_USE_MPI
+   os << "\nmfem_serial_mesh_end\n"
+      << "\ncommunication_groups\nnumber_of_groups " << groups.size() << "\n\n"
+      << "# number of entities in each group, followed by group ids in group\n";
+   for (int gr = 0; gr < (int) groups.size(); gr++)
+   {
+      os << groups[gr].size();
+      for (int i = 0; i < (int) groups[gr].size(); i++)
+      {
+         os << ' ' << groups[gr][i];
+      }
+      os << '\n';
+   }
+   const char *shared_name[3] =
+   { "shared_vertices", "shared_edges", "shared_faces" };
+   os << "\ntotal_shared_vertices " << num_shared[0] << '\n';
+   os << "total_shared_edges " << num_shared[1] << '\n';
+   if (dim == 3) { os << "total_shared_faces " << num_shared[2] << '\n'; }
+   for (int gr = 1; gr < (int) groups.size(); gr++)
+   {
+      os << "\n#group " << gr << '\n';
+      for (int t = 0; t < dim; t++)
+      {
+         const int nev = 1 << t;
+         const vector<int> &list = shared[t][gr];
+         os << (t > 0 ? "\n" : "") << shared_name[t] << ' '
+            << list.size() / nev << '\n';
+         for (int i = 0; i < (int) list.size(); i += nev)
+         {
+            if (t == 2) { os << Geometry::SQUARE << ' '; }
+            for (int c = 0; c < nev; c++)
+            {
+               os << list[i+c] << ((c == nev - 1) ? '\n' : ' ');
+            }
+         }
+      }
+   }
+   os << "\nmfem_mesh_end" << endl;
+#endif
+
+   istringstream mesh_is(os.str());
+   ParMesh *pmesh = new ParMesh(comm, mesh_is);
+
+   // The attribute lists are global, as in meshes partitioned in serial.
+   vector<int> attr(coarse_attr), bdr;
+   for (int d = 0; d < dim; d++)
+   {
+      bdr.push_back(bdr_attr[d][0]);
+      bdr.push_back(bdr_attr[d][1]);
+   }
+   sort(attr.begin(), attr.end());
+   attr.erase(unique(attr.begin(), attr.end()), attr.end());
+   sort(bdr.begin(), bdr.end());
+   bdr.erase(unique(bdr.begin(), bdr.end()), bdr.end());
+   pmesh->attributes.SetSize((int) attr.size());
+   for (int i = 0; i < (int) attr.size(); i++)
+   {
+      pmesh->attributes[i] = attr[i];
+   }
+   pmesh->bdr_attributes.SetSize((int) bdr.size());
+   for (int i = 0; i < (int) bdr.size(); i++)
+   {
+      pmesh->bdr_attributes[i] = bdr[i];
+   }
+   return pmesh;
+}
+
+} // namespace hydrodynamics
+
+} // namespace mfem
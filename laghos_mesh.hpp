@@ -0,0 +1,83 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_MESH
+#define MFEM_LAGHOS_MESH
+
+#include "laghos_compat.hpp"
+
+#include <vector>
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// Generates the parallel mesh of an axis-aligned tensor-product grid of
+// quadrilaterals or hexahedra directly in parallel. Every task creates only
+// its own part of the refined mesh, together with the shared vertices, edges
+// and faces it needs, so the memory and the setup time depend on the local
+// problem size instead of the global one.
+//
+// The result is the same mesh that uniform refinement of the serial mesh and
+// Mesh::CartesianPartitioning() produce, up to the local numbering of the
+// vertices and the zones.
+class CartesianMeshGenerator
+{
+private:
+   int dim, levels;
+
+   // Sorted vertex coordinates in each direction.
+   std::vector<double> coord[3];
+
+   // Zone attributes of the unrefined grid, and boundary attributes of its
+   // low and high sides in each direction.
+   int coarse_nz[3];
+   std::vector<int> coarse_attr;
+   int bdr_attr[3][2];
+
+   // Index of the coordinate x in direction d, or -1 if x isn't a grid line.
+   int CoordIndex(int d, double x) const;
+
+   // Grid index range of the vertices v in each direction, and the bit mask of
+   // the box corners they hit. Returns false if some vertex is off the grid.
+   bool GetBox(const Mesh &mesh, const Array<int> &v,
+               int *lo, int *hi, int &corners) const;
+
+public:
+   CartesianMeshGenerator() : dim(0), levels(0) { }
+
+   // Extracts the grid from the serial mesh. Returns false when the mesh isn't
+   // an axis-aligned tensor-product grid with constant boundary attributes on
+   // each of its sides.
+   bool Init(const Mesh &mesh);
+
+   // Equivalent to the given number of Mesh::UniformRefinement() calls.
+   void Refine(int ref_levels);
+
+   int NumZones(int d) const { return (int) coord[d].size() - 1; }
+
+   // Creates the local part of the parallel mesh for an nxyz[0] x ... task
+   // grid. Returns NULL when some task would get no zones. Collective.
+   ParMesh *MakeParMesh(MPI_Comm comm, const int *nxyz) const;
+};
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_LAGHOS_MESH
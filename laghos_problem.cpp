@@ -0,0 +1,185 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#include "laghos_problem.hpp"
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+double ProblemSetup::rho0(const Vector &x) const
+{
+   switch (problem)
+   {
+      case 0: return 1.0;
+      case 1: return 1.0;
+      case 2: if (x(0) < 0.5) { return 1.0; }
+         else { return 0.1; }
+      case 3: if (x(0) > 1.0 && x(1) <= 1.5) { return 1.0; }
+         else { return 0.125; }
+      default: MFEM_ABORT("Bad number given for problem id!"); return 0.0;
+   }
+}
+
+double ProblemSetup::gamma(const Vector &x) const
+{
+   if (gamma_value > 0.0) { return gamma_value; }
+   switch (problem)
+   {
+      case 0: return 5./3.;
+      case 1: return 1.4;
+      case 2: return 1.4;
+      case 3: if (x(0) > 1.0 && x(1) <= 1.5) { return 1.4; }
+         else { return 1.5; }
+      default: MFEM_ABORT("Bad number given for problem id!"); return 0.0;
+   }
+}
+
+void ProblemSetup::v0(const Vector &x, Vector &v) const
+{
+   switch (problem)
+   {
+      case 0:
+         v(0) =  sin(M_PI*x(0)) * cos(M_PI*x(1));
+         v(1) = -cos(M_PI*x(0)) * sin(M_PI*x(1));
+         if (x.Size() == 3)
+         {
+            v(0) *= cos(M_PI*x(2));
+            v(1) *= cos(M_PI*x(2));
+            v(2) = 0.0;
+         }
+         break;
+      case 1: v = 0.0; break;
+      case 2: v = 0.0; break;
+      case 3: v = 0.0; break;
+      default: MFEM_ABORT("Bad number given for problem id!");
+   }
+}
+
+double ProblemSetup::e0(const Vector &x) const
+{
+   double val;
+   switch (problem)
+   {
+      case 0:
+      {
+         // (gamma - 1) * density, so that the pressure of the vortex doesn't
+         // depend on gamma.
+         const double denom = (gamma_value > 0.0) ? gamma_value - 1.0
+                              : 2.0 / 3.0;
+         if (x.Size() == 2)
+         {
+            val = 1.0 + (cos(2*M_PI*x(0)) + cos(2*M_PI*x(1))) / 4.0;
+         }
+         else
+         {
+            val = 100.0 + ((cos(2*M_PI*x(2)) + 2) *
+                           (cos(2*M_PI*x(0)) + cos(2*M_PI*x(1))) - 2) / 16.0;
+         }
+         val /= denom;
+         break;
+      }
+      // This case is initialized in ProjectInitialConditions().
+      case 1: val = 0.0; break;
+      case 2: if (x(0) < 0.5) { val = 1.0 / rho0(x) / (gamma(x) - 1.0); }
+         else { val = 0.1 / rho0(x) / (gamma(x) - 1.0); }
+         break;
+      case 3: if (x(0) > 1.0) { val = 0.1 / rho0(x) / (gamma(x) - 1.0); }
+         else { val = 1.0 / rho0(x) / (gamma(x) - 1.0); }
+         break;
+      default: MFEM_ABORT("Bad number given for problem id!"); return 0.0;
+   }
+   return energy_scale * val;
+}
+
+double ProblemSetup::SourceScale() const
+{
+   // The Taylor-Green source keeps the vortex steady for gamma = 5/3; with the
+   // pressure fixed, it is proportional to 1 / (gamma - 1).
+   if (problem == 0 && gamma_value > 0.0)
+   {
+      return (2.0 / 3.0) / (gamma_value - 1.0);
+   }
+   return 1.0;
+}
+
+void ProblemSetup::ProjectInitialConditions(ParGridFunction &rho,
+                                            ParGridFunction *v,
+                                            ParGridFunction *e) const
+{
+   ParFiniteElementSpace &L2FESpace = *rho.ParFESpace();
+   ParMesh *pmesh = L2FESpace.GetParMesh();
+   const int dim = pmesh->Dimension();
+
+   if (v)
+   {
+      ProblemVelocityCoefficient v_coeff(*this, dim);
+      v->ProjectCoefficient(v_coeff);
+   }
+
+   // We interpolate in a non-positive basis to get the correct values at the
+   // dofs. Then we do an L2 projection to the positive basis in which we
+   // actually compute. The goal is to get a high-order representation of the
+   // initial condition.
+   ProblemCoefficient rho_coeff(*this, ProblemCoefficient::DENSITY);
+   L2_FECollection l2_fec(L2FESpace.GetOrder(0), dim);
+   ParFiniteElementSpace l2_fes(pmesh, &l2_fec);
+   ParGridFunction l2_rho(&l2_fes), l2_e(&l2_fes);
+   l2_rho.ProjectCoefficient(rho_coeff);
+   rho.ProjectGridFunction(l2_rho);
+   if (e)
+   {
+      if (problem == 1)
+      {
+         // For the Sedov test, we use a delta function at the origin.
+         DeltaCoefficient e_coeff(0, 0, 0.25 * energy_scale);
+         l2_e.ProjectCoefficient(e_coeff);
+      }
+      else
+      {
+         ProblemCoefficient e_coeff(*this, ProblemCoefficient::ENERGY);
+         l2_e.ProjectCoefficient(e_coeff);
+      }
+      e->ProjectGridFunction(l2_e);
+   }
+}
+
+double ProblemCoefficient::Eval(const Vector &x) const
+{
+   switch (field)
+   {
+      case DENSITY: return setup.rho0(x);
+      case ENERGY: return setup.e0(x);
+      case GAMMA: return setup.gamma(x);
+   }
+   return 0.0;
+}
+
+void ProblemVelocityCoefficient::Eval(Vector &V, ElementTransformation &T,
+                                      const IntegrationPoint &ip)
+{
+   double x[3];
+   Vector transip(x, 3);
+   T.Transform(ip, transip);
+   V.SetSize(vdim);
+   setup.v0(transip, V);
+}
+
+} // namespace hydrodynamics
+
+} // namespace mfem
@@ -0,0 +1,109 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_PROBLEM
+#define MFEM_LAGHOS_PROBLEM
+
+#include "laghos_compat.hpp"
+#include "laghos_solver.hpp"
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// Initial conditions, material and source of the test problems for one
+// simulation:
+//    0 --> Taylor-Green vortex, 1 --> Sedov blast, 2 --> 1D Sod shock tube,
+//    3 --> triple point.
+// Each simulation has its own setup, so simulations of different problems and
+// parameters can run in one process. The parameters perturb the standard
+// problems, e.g., for the members of an ensemble.
+class ProblemSetup
+{
+public:
+   const int problem;
+   // Ideal gas constant of the whole domain, used instead of the one of the
+   // problem when positive. The initial energies of problems 0, 2 and 3 are
+   // adjusted to keep their initial pressures, and the Taylor-Green energy
+   // source to keep the vortex steady.
+   double gamma_value;
+   // Scale of the initial specific internal energy; for Sedov, of the energy
+   // of the blast.
+   double energy_scale;
+
+   ProblemSetup(int p) : problem(p), gamma_value(0.0), energy_scale(1.0) { }
+
+   bool Valid() const { return problem >= 0 && problem <= 3; }
+
+   double rho0(const Vector &x) const;
+   double gamma(const Vector &x) const;
+   void v0(const Vector &x, Vector &v) const;
+   double e0(const Vector &x) const;
+
+   // Energy source type of LagrangianHydroOperator and whether the problem
+   // needs artificial viscosity.
+   int SourceType(int dim) const { return (problem == 0 && dim == 2) ? 1 : 0; }
+   // Scale of the energy source, see LagrangianHydroOperator::SetSourceScale.
+   double SourceScale() const;
+   bool Viscosity() const { return problem != 0; }
+
+   // Projects the initial density onto rho, a function of the thermodynamic
+   // space, and, when given, the initial velocity and energy onto v and e.
+   void ProjectInitialConditions(ParGridFunction &rho, ParGridFunction *v,
+                                 ParGridFunction *e) const;
+};
+
+// A scalar field of a ProblemSetup as a position coefficient; GAMMA is the
+// material coefficient of LagrangianHydroOperator.
+class ProblemCoefficient : public PositionCoefficient
+{
+public:
+   enum Field { DENSITY, ENERGY, GAMMA };
+
+private:
+   const ProblemSetup &setup;
+   const Field field;
+
+public:
+   ProblemCoefficient(const ProblemSetup &setup_, Field field_)
+      : setup(setup_), field(field_) { }
+
+   using PositionCoefficient::Eval;
+   virtual double Eval(const Vector &x) const;
+};
+
+// The initial velocity of a ProblemSetup.
+class ProblemVelocityCoefficient : public VectorCoefficient
+{
+private:
+   const ProblemSetup &setup;
+
+public:
+   ProblemVelocityCoefficient(const ProblemSetup &setup_, int dim)
+      : VectorCoefficient(dim), setup(setup_) { }
+
+   using VectorCoefficient::Eval;
+   virtual void Eval(Vector &V, ElementTransformation &T,
+                     const IntegrationPoint &ip);
+};
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_LAGHOS_PROBLEM
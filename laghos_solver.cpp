@@ -15,8 +15,12 @@
 // testbed platforms, in support of the nation's exascale computing imperative.
 
 #include "laghos_solver.hpp"
+#include "laghos_io.hpp"
 
-#ifdef MFEM_USE_MPI
+#include <iomanip>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
@@ -26,6 +30,29 @@ namespace mfem
 namespace hydrodynamics
 {
 
+// Number of zones in the batches of the quadrature data computations.
+static const int nzones_batch = 3;
+
+// Number of OpenMP threads of UpdateQuadratureData and the calling thread's
+// index; 1 and 0 without OpenMP.
+static int NumThreads()
+{
+#ifdef _OPENMP
+   return omp_get_max_threads();
+#else
+   return 1;
+#endif
+}
+
+static int ThreadNum()
+{
+#ifdef _OPENMP
+   return omp_get_thread_num();
+#else
+   return 0;
+#endif
+}
+
 void VisualizeField(socketstream &sock, const char *vishost, int visport,
                     ParGridFunction &gf, const char *title,
                     int x, int y, int w, int h, bool vec)
@@ -75,6 +102,16 @@ void VisualizeField(socketstream &sock, const char *vishost, int visport,
    while (connection_failed);
 }
 
+// Cost of a CG solve with the given operator cost: one operator application,
+// two dot products and three vector updates of the given size per iteration.
+static KernelCost CGCost(const KernelCost &op, int size, int iterations)
+{
+   KernelCost cost(op.flops + 10.0 * size,
+                   op.bytes + 13.0 * sizeof(double) * size);
+   cost *= iterations;
+   return cost;
+}
+
 LagrangianHydroOperator::LagrangianHydroOperator(int size,
                                                  ParFiniteElementSpace &h1_fes,
                                                  ParFiniteElementSpace &l2_fes,
@@ -83,6 +120,7 @@ LagrangianHydroOperator::LagrangianHydroOperator(int size,
                                                  int source_type_, double cfl_,
                                                  Coefficient *material_,
                                                  bool visc, bool pa,
+                                                 bool otf,
                                                  double cgt, int cgiter)
    : TimeDependentOperator(size),
      H1FESpace(h1_fes), L2FESpace(l2_fes),
@@ -91,21 +129,37 @@ LagrangianHydroOperator::LagrangianHydroOperator(int size,
      nzones(h1_fes.GetMesh()->GetNE()),
      l2dofs_cnt(l2_fes.GetFE(0)->GetDof()),
      h1dofs_cnt(h1_fes.GetFE(0)->GetDof()),
-     source_type(source_type_), cfl(cfl_),
-     use_viscosity(visc), p_assembly(pa), cg_rel_tol(cgt), cg_max_iter(cgiter),
+     source_type(source_type_), source_scale(1.0), cfl(cfl_),
+     use_viscosity(visc), p_assembly(pa), force_otf(otf),
+     cg_rel_tol(cgt), cg_max_iter(cgiter),
      material_pcf(material_),
+     material_pos(dynamic_cast<PositionCoefficient *>(material_)),
      Mv(&h1_fes), Me_inv(l2dofs_cnt, l2dofs_cnt, nzones),
      integ_rule(IntRules.Get(h1_fes.GetMesh()->GetElementBaseGeometry(),
                              3*h1_fes.GetOrder(0) + l2_fes.GetOrder(0) - 1)),
-     quad_data(dim, nzones, integ_rule.GetNPoints()),
-     quad_data_is_current(false),
-     Force(&l2_fes, &h1_fes), ForcePA(&quad_data, h1_fes, l2_fes),
-     VMassPA(&quad_data, H1FESpace), locEMassPA(&quad_data, l2_fes),
+     quad_data(dim, nzones, integ_rule.GetNPoints(), !force_otf),
+     quad_data_state(NULL), state_version(0), quad_data_version(-1),
+     quad_data_dt_est(numeric_limits<double>::infinity()),
+     dt_reduction(h1_fes.GetParMesh()->GetComm()),
+     glob_min_detJ(numeric_limits<double>::infinity()),
+     Force(&l2_fes, &h1_fes),
+     tensors1D(pa ? new Tensors1D(h1_fes.GetFE(0)->GetOrder(),
+                                  l2_fes.GetFE(0)->GetOrder(),
+                                  Tensors1D::NumQuad1D(integ_rule.GetNPoints(),
+                                                       dim))
+              : NULL),
+     evaluator(pa ? new FastEvaluator(h1_fes, tensors1D) : NULL),
+     ForcePA(&quad_data, tensors1D, h1_fes, l2_fes),
+     VMassPA(&quad_data, tensors1D, H1FESpace),
+     locEMassPA(&quad_data, tensors1D, l2_fes),
      locCG(), timer()
 {
+   MFEM_VERIFY(!force_otf || p_assembly,
+               "The on-the-fly force needs partial assembly.");
    GridFunctionCoefficient rho_coeff(&rho0);
 
    // Standard local assembly and inversion for energy mass matrices.
+   timer.setup.Start("Energy mass inverses");
    DenseMatrix Me(l2dofs_cnt);
    DenseMatrixInverse inv(&Me);
    MassIntegrator mi(rho_coeff, &integ_rule);
@@ -118,11 +172,18 @@ LagrangianHydroOperator::LagrangianHydroOperator(int size,
    }
 
    // Standard assembly for the velocity mass matrix.
+   timer.setup.Start("Velocity mass assembly");
    VectorMassIntegrator *vmi = new VectorMassIntegrator(rho_coeff, &integ_rule);
    Mv.AddDomainIntegrator(vmi);
    Mv.Assemble();
+   if (!p_assembly)
+   {
+      Mv.Finalize();
+      Mv_spmat_copy = Mv.SpMat();
+   }
 
    // Values of rho0DetJ0 and Jac0inv at all quadrature points.
+   timer.setup.Start("Initial quadrature data");
    const int nqp = integ_rule.GetNPoints();
    Vector rho_vals(nqp);
    for (int i = 0; i < nzones; i++)
@@ -144,6 +205,7 @@ LagrangianHydroOperator::LagrangianHydroOperator(int size,
    }
 
    // Initial local mesh size (assumes all mesh elements are of the same type).
+   timer.setup.Start("Initial mesh size");
    double loc_area = 0.0, glob_area;
    int loc_z_cnt = nzones, glob_z_cnt;
    ParMesh *pm = H1FESpace.GetParMesh();
@@ -166,19 +228,50 @@ LagrangianHydroOperator::LagrangianHydroOperator(int size,
    }
    quad_data.h0 /= (double) H1FESpace.GetOrder(0);
 
+   timer.setup.Start("Force sparsity");
    ForceIntegrator *fi = new ForceIntegrator(quad_data);
    fi->SetIntRule(&integ_rule);
    Force.AddDomainIntegrator(fi);
-   // Make a dummy assembly to figure out the sparsity.
-   Force.Assemble(0);
-   Force.Finalize(0);
+   // Make a dummy assembly to figure out the sparsity. The on-the-fly force
+   // never uses the matrix, and has no stress for the assembly.
+   if (!force_otf)
+   {
+      Force.Assemble(0);
+      Force.Finalize(0);
+   }
 
    if (p_assembly)
    {
-      tensors1D = new Tensors1D(H1FESpace.GetFE(0)->GetOrder(),
-                                L2FESpace.GetFE(0)->GetOrder(),
-                                int(floor(0.7 + pow(nqp, 1.0 / dim))));
-      evaluator = new FastEvaluator(H1FESpace);
+      timer.setup.Start("Partial assembly dof maps");
+      MFEM_VERIFY(material_pcf == NULL || material_pos != NULL,
+                  "Partial assembly needs the material as a "
+                  "PositionCoefficient.");
+      Array<int> dofs;
+      h1_zone_vdofs.SetSize(nzones * h1dofs_cnt * dim);
+      l2_zone_dofs.SetSize(nzones * l2dofs_cnt);
+      for (int z = 0; z < nzones; z++)
+      {
+         H1FESpace.GetElementVDofs(z, dofs);
+         for (int j = 0; j < h1dofs_cnt * dim; j++)
+         {
+            h1_zone_vdofs[z * h1dofs_cnt * dim + j] = dofs[j];
+         }
+         L2FESpace.GetElementDofs(z, dofs);
+         for (int j = 0; j < l2dofs_cnt; j++)
+         {
+            l2_zone_dofs[z * l2dofs_cnt + j] = dofs[j];
+         }
+      }
+   }
+
+   thread_h1_fec.SetSize(NumThreads());
+   thread_l2_fec.SetSize(NumThreads());
+   for (int t = 0; t < thread_h1_fec.Size(); t++)
+   {
+      thread_h1_fec[t] =
+         FiniteElementCollection::New(H1FESpace.FEColl()->Name());
+      thread_l2_fec[t] =
+         FiniteElementCollection::New(L2FESpace.FEColl()->Name());
    }
 
    locCG.SetOperator(locEMassPA);
@@ -187,159 +280,238 @@ LagrangianHydroOperator::LagrangianHydroOperator(int size,
    locCG.SetAbsTol(1e-8 * numeric_limits<double>::epsilon());
    locCG.SetMaxIter(200);
    locCG.SetPrintLevel(0);
+   timer.setup.Stop();
 }
 
 void LagrangianHydroOperator::Mult(const Vector &S, Vector &dS_dt) const
 {
+   EventTrace::Begin("RK stage");
    dS_dt = 0.0;
 
    // Make sure that the mesh positions correspond to the ones in S. This is
-   // needed only because some mfem time integrators don't update the solution
+   // needed only because some time integrators don't update the solution
    // vector at every intermediate stage (hence they don't change the mesh).
-   Vector* sptr = (Vector*) &S;
-   ParGridFunction x;
-   x.MakeRef(&H1FESpace, *sptr, 0);
-   H1FESpace.GetParMesh()->NewNodes(x, false);
-
-   UpdateQuadratureData(S);
+   UpdateMesh(S);
 
    // The monolithic BlockVector stores the unknown fields as follows:
    // - Position
    // - Velocity
    // - Specific Internal Energy
 
-   const int VsizeL2 = L2FESpace.GetVSize();
    const int VsizeH1 = H1FESpace.GetVSize();
-
-   ParGridFunction v, e;
-   v.MakeRef(&H1FESpace, *sptr, VsizeH1);
-   e.MakeRef(&L2FESpace, *sptr, VsizeH1*2);
-
-   ParGridFunction dx, dv, de;
-   dx.MakeRef(&H1FESpace, dS_dt, 0);
-   dv.MakeRef(&H1FESpace, dS_dt, VsizeH1);
-   de.MakeRef(&L2FESpace, dS_dt, VsizeH1*2);
+   Vector* sptr = (Vector*) &S;
+   Vector v, dx, dv, de;
+   v.SetDataAndSize(sptr->GetData() + VsizeH1, VsizeH1);
+   dx.SetDataAndSize(dS_dt.GetData(), VsizeH1);
+   dv.SetDataAndSize(dS_dt.GetData() + VsizeH1, VsizeH1);
+   de.SetDataAndSize(dS_dt.GetData() + 2*VsizeH1, L2FESpace.GetVSize());
 
    // Set dx_dt = v (explicit).
    dx = v;
 
-   if (!p_assembly)
+   SolveVelocityEnergy(S, dv, de);
+
+   // The integrators may update their stage vectors in place.
+   state_version++;
+   EventTrace::End();
+}
+
+void LagrangianHydroOperator::UpdateMesh(const Vector &S) const
+{
+   Vector* sptr = (Vector*) &S;
+   ParGridFunction x;
+   x.MakeRef(&H1FESpace, *sptr, 0);
+   H1FESpace.GetParMesh()->NewNodes(x, false);
+}
+
+void LagrangianHydroOperator::GetStateBlocks(const Vector &S, Vector &x,
+                                             Vector &v, Vector &e) const
+{
+   const int VsizeH1 = H1FESpace.GetVSize();
+   Vector* sptr = (Vector*) &S;
+   x.SetDataAndSize(sptr->GetData(), VsizeH1);
+   v.SetDataAndSize(sptr->GetData() + VsizeH1, VsizeH1);
+   e.SetDataAndSize(sptr->GetData() + 2*VsizeH1, L2FESpace.GetVSize());
+}
+
+void LagrangianHydroOperator::SolveVelocity(const Vector &S, Vector &dv) const
+{
+   Vector rhs(H1FESpace.GetVSize());
+   if (force_otf) { ForceOnTheFly(S, NULL, &rhs, NULL); }
+   else
    {
-      Force = 0.0;
+      UpdateQuadratureData(S);
+
+      if (!p_assembly)
+      {
+         Force = 0.0;
+         EventTrace::Begin("Force assembly");
+         timer.sw_force.Start();
+         Force.Assemble();
+         timer.sw_force.Stop();
+         EventTrace::End();
+      }
+
+      Vector one(L2FESpace.GetVSize()); one = 1.0;
+      EventTrace::Begin("Force");
       timer.sw_force.Start();
-      Force.Assemble();
+      if (p_assembly) { ForcePA.Mult(one, rhs); }
+      else { Force.Mult(one, rhs); }
       timer.sw_force.Stop();
+      EventTrace::End();
+      if (p_assembly) { timer.cost_force += ForcePA.MultCost(); }
    }
+   VelocitySolve(rhs, dv);
+}
 
-   // Solve for velocity.
-   Vector one(VsizeL2), rhs(VsizeH1), B, X; one = 1.0;
-   if (p_assembly)
+void LagrangianHydroOperator::SolveVelocityEnergy(const Vector &S,
+                                                  Vector &dv, Vector &de) const
+{
+   Vector x, v, e;
+   GetStateBlocks(S, x, v, e);
+   if (force_otf)
    {
-      timer.sw_force.Start();
-      ForcePA.Mult(one, rhs);
-      timer.sw_force.Stop();
-      rhs.Neg();
+      // Both force actions in the pass that computes the stress.
+      Vector rhs(H1FESpace.GetVSize()), e_rhs(L2FESpace.GetVSize());
+      ForceOnTheFly(S, &v, &rhs, &e_rhs);
+      VelocitySolve(rhs, dv);
+      EnergySolve(e_rhs, de);
+   }
+   else
+   {
+      SolveVelocity(S, dv);
+      SolveEnergy(S, v, de);
+   }
+}
 
+void LagrangianHydroOperator::VelocitySolve(Vector &rhs, Vector &dv) const
+{
+   Vector B, X;
+   dv = 0.0;
+   rhs.Neg();
+#ifdef MFEM_USE_MPI
+   CGSolver cg(H1FESpace.GetComm());
+#else
+   CGSolver cg;
+#endif
+   cg.SetRelTol(cg_rel_tol); cg.SetAbsTol(0.0);
+   cg.SetMaxIter(cg_max_iter);
+   cg.SetPrintLevel(0);
+   if (p_assembly)
+   {
       Operator *cVMassPA;
       VMassPA.FormLinearSystem(ess_tdofs, dv, rhs, cVMassPA, X, B);
-      CGSolver cg(H1FESpace.GetParMesh()->GetComm());
       cg.SetOperator(*cVMassPA);
-      cg.SetRelTol(cg_rel_tol); cg.SetAbsTol(0.0);
-      cg.SetMaxIter(cg_max_iter);
-      cg.SetPrintLevel(0);
+      EventTrace::Begin("CG (H1)");
       timer.sw_cgH1.Start();
       cg.Mult(B, X);
       timer.sw_cgH1.Stop();
+      EventTrace::End();
       timer.H1cg_iter += cg.GetNumIterations();
+      timer.cost_cgH1 += CGCost(VMassPA.MultCost(), X.Size(),
+                                cg.GetNumIterations());
       VMassPA.RecoverFEMSolution(X, rhs, dv);
       delete cVMassPA;
    }
    else
    {
-      timer.sw_force.Start();
-      Force.Mult(one, rhs);
-      timer.sw_force.Stop();
-      rhs.Neg();
-
       HypreParMatrix A;
       Mv.FormLinearSystem(ess_tdofs, dv, rhs, A, X, B);
-      CGSolver cg(H1FESpace.GetParMesh()->GetComm());
       cg.SetOperator(A);
-      cg.SetRelTol(cg_rel_tol); cg.SetAbsTol(0.0);
-      cg.SetMaxIter(cg_max_iter);
-      cg.SetPrintLevel(0);
+      EventTrace::Begin("CG (H1)");
       timer.sw_cgH1.Start();
       cg.Mult(B, X);
       timer.sw_cgH1.Stop();
+      EventTrace::End();
       timer.H1cg_iter += cg.GetNumIterations();
       Mv.RecoverFEMSolution(X, rhs, dv);
    }
+}
+
+void LagrangianHydroOperator::SolveEnergy(const Vector &S, const Vector &v,
+                                          Vector &de) const
+{
+   Vector e_rhs(L2FESpace.GetVSize());
+   if (force_otf) { ForceOnTheFly(S, &v, NULL, &e_rhs); }
+   else
+   {
+      UpdateQuadratureData(S);
+
+      EventTrace::Begin("Force transpose");
+      timer.sw_force.Start();
+      if (p_assembly) { ForcePA.MultTranspose(v, e_rhs); }
+      else { Force.MultTranspose(v, e_rhs); }
+      timer.sw_force.Stop();
+      EventTrace::End();
+      if (p_assembly) { timer.cost_force += ForcePA.MultTransposeCost(); }
+   }
+   EnergySolve(e_rhs, de);
+}
 
-   // Solve for energy, assemble the energy source if such exists.
+void LagrangianHydroOperator::EnergySolve(Vector &e_rhs, Vector &de) const
+{
+   // Assemble the energy source if such exists.
    LinearForm *e_source = NULL;
    if (source_type == 1) // 2D Taylor-Green.
    {
       e_source = new LinearForm(&L2FESpace);
-      TaylorCoefficient coeff;
+      TaylorCoefficient coeff(source_scale);
       DomainLFIntegrator *d = new DomainLFIntegrator(coeff, &integ_rule);
       e_source->AddDomainIntegrator(d);
       e_source->Assemble();
    }
+   if (e_source) { e_rhs += *e_source; }
+
    Array<int> l2dofs;
-   Vector e_rhs(VsizeL2), loc_rhs(l2dofs_cnt), loc_de(l2dofs_cnt);
-   if (p_assembly)
+   Vector loc_rhs(l2dofs_cnt), loc_de(l2dofs_cnt);
+   EventTrace::Begin("Energy solve (L2)");
+   for (int z = 0; z < nzones; z++)
    {
-      timer.sw_force.Start();
-      ForcePA.MultTranspose(v, e_rhs);
-      timer.sw_force.Stop();
-
-      if (e_source) { e_rhs += *e_source; }
-      for (int z = 0; z < nzones; z++)
+      L2FESpace.GetElementDofs(z, l2dofs);
+      e_rhs.GetSubVector(l2dofs, loc_rhs);
+      if (p_assembly)
       {
-         L2FESpace.GetElementDofs(z, l2dofs);
-         e_rhs.GetSubVector(l2dofs, loc_rhs);
          locEMassPA.SetZoneId(z);
          timer.sw_cgL2.Start();
          locCG.Mult(loc_rhs, loc_de);
          timer.sw_cgL2.Stop();
          timer.L2dof_iter += locCG.GetNumIterations() * l2dofs_cnt;
-         de.SetSubVector(l2dofs, loc_de);
+         timer.cost_cgL2 += CGCost(locEMassPA.MultCost(), l2dofs_cnt,
+                                   locCG.GetNumIterations());
       }
-   }
-   else
-   {
-      timer.sw_force.Start();
-      Force.MultTranspose(v, e_rhs);
-      timer.sw_force.Stop();
-      if (e_source) { e_rhs += *e_source; }
-      for (int z = 0; z < nzones; z++)
+      else
       {
-         L2FESpace.GetElementDofs(z, l2dofs);
-         e_rhs.GetSubVector(l2dofs, loc_rhs);
          timer.sw_cgL2.Start();
          Me_inv(z).Mult(loc_rhs, loc_de);
          timer.sw_cgL2.Stop();
          timer.L2dof_iter += l2dofs_cnt;
-         de.SetSubVector(l2dofs, loc_de);
       }
+      de.SetSubVector(l2dofs, loc_de);
    }
+   EventTrace::End();
    delete e_source;
-
-   quad_data_is_current = false;
 }
 
-double LagrangianHydroOperator::GetTimeStepEstimate(const Vector &S) const
+double LagrangianHydroOperator::GetTimeStepEstimate(
+   const Vector &S, GlobalReduction *reduction) const
 {
-   Vector* sptr = (Vector*) &S;
-   ParGridFunction x;
-   x.MakeRef(&H1FESpace, *sptr, 0);
-   H1FESpace.GetParMesh()->NewNodes(x, false);
+   UpdateMesh(S);
    UpdateQuadratureData(S);
 
-   double glob_dt_est;
-   MPI_Allreduce(&quad_data.dt_est, &glob_dt_est, 1, MPI_DOUBLE, MPI_MIN,
-                 H1FESpace.GetParMesh()->GetComm());
-   return glob_dt_est;
+   if (reduction == NULL)
+   {
+      reduction = &dt_reduction;
+      reduction->Clear();
+   }
+   EventTrace::Begin("dt Allreduce");
+   timer.sw_dt.Start();
+   const int dt_slot = reduction->Min(quad_data.dt_est),
+             detJ_slot = reduction->Min(quad_data.min_detJ);
+   reduction->Reduce();
+   timer.sw_dt.Stop();
+   EventTrace::End();
+   glob_min_detJ = reduction->Get(detJ_slot);
+   return reduction->Get(dt_slot);
 }
 
 void LagrangianHydroOperator::ResetTimeStepEstimate() const
@@ -347,6 +519,32 @@ void LagrangianHydroOperator::ResetTimeStepEstimate() const
    quad_data.dt_est = numeric_limits<double>::infinity();
 }
 
+void LagrangianHydroOperator::ComputeLocalTotals(const Vector &S,
+                                                 Vector &totals) const
+{
+   UpdateMesh(S);
+   UpdateQuadratureData(S);
+
+   // The local mass matrix action gives the momentum (the basis functions sum
+   // to one) and the kinetic energy; summing the local values over the ranks
+   // adds up the contributions of all zones.
+   const int VsizeH1 = H1FESpace.GetVSize(), ndofs = H1FESpace.GetNDofs();
+   Vector* sptr = (Vector*) &S;
+   Vector v(sptr->GetData() + VsizeH1, VsizeH1), Mv_v(VsizeH1);
+   if (p_assembly) { VMassPA.Mult(v, Mv_v); }
+   else { Mv_spmat_copy.Mult(v, Mv_v); }
+
+   totals.SetSize(dim + 3);
+   totals(0) = quad_data.rho0DetJ0w.Sum();
+   for (int d = 0; d < dim; d++)
+   {
+      Vector Mv_d(Mv_v.GetData() + d * ndofs, ndofs);
+      totals(1 + d) = Mv_d.Sum();
+   }
+   totals(dim + 1) = 0.5 * (v * Mv_v);
+   totals(dim + 2) = quad_data.internal_energy;
+}
+
 void LagrangianHydroOperator::ComputeDensity(ParGridFunction &rho)
 {
    rho.SetSpace(&L2FESpace);
@@ -371,250 +569,799 @@ void LagrangianHydroOperator::ComputeDensity(ParGridFunction &rho)
    }
 }
 
-void LagrangianHydroOperator::PrintTimingData(bool IamRoot, int steps)
+void LagrangianHydroOperator::PrintTimingData(bool IamRoot, int steps,
+                                              const PhaseTimer *startup,
+                                              JSONWriter *json)
 {
-   double my_rt[5], rt_max[5];
-   my_rt[0] = timer.sw_cgH1.RealTime();
-   my_rt[1] = timer.sw_cgL2.RealTime();
-   my_rt[2] = timer.sw_force.RealTime();
-   my_rt[3] = timer.sw_qdata.RealTime();
+   MPI_Comm comm = H1FESpace.GetComm();
+   int num_procs;
+   MPI_Comm_size(comm, &num_procs);
+
+   double my_rt[5], rt_min[5], rt_sum[5], rt_max[5];
+   my_rt[0] = timer.sw_cgH1.RealTime() + timer.restart_rt[0];
+   my_rt[1] = timer.sw_cgL2.RealTime() + timer.restart_rt[1];
+   my_rt[2] = timer.sw_force.RealTime() + timer.restart_rt[2];
+   my_rt[3] = timer.sw_qdata.RealTime() + timer.restart_rt[3];
    my_rt[4] = my_rt[0] + my_rt[2] + my_rt[3];
-   MPI_Reduce(my_rt, rt_max, 5, MPI_DOUBLE, MPI_MAX, 0, H1FESpace.GetComm());
+   MPI_Reduce(my_rt, rt_max, 5, MPI_DOUBLE, MPI_MAX, 0, comm);
+   MPI_Reduce(my_rt, rt_min, 5, MPI_DOUBLE, MPI_MIN, 0, comm);
+   MPI_Reduce(my_rt, rt_sum, 5, MPI_DOUBLE, MPI_SUM, 0, comm);
 
    HYPRE_Int mydata[2], alldata[2];
    mydata[0] = timer.L2dof_iter;
    mydata[1] = timer.quad_tstep;
-   MPI_Reduce(mydata, alldata, 2, HYPRE_MPI_INT, MPI_SUM, 0,
-              H1FESpace.GetComm());
+   MPI_Reduce(mydata, alldata, 2, HYPRE_MPI_INT, MPI_SUM, 0, comm);
+
+   const HYPRE_Int H1gsize = H1FESpace.GlobalTrueVSize(),
+                   L2gsize = L2FESpace.GlobalTrueVSize();
+   const long long nzones_glob = H1FESpace.GetParMesh()->GetGlobalNE();
+   double rates[5];
+   rates[0] = 1e-6 * H1gsize * timer.H1cg_iter / rt_max[0];
+   rates[1] = 1e-6 * alldata[0] / rt_max[1];
+   rates[2] = 1e-6 * steps * (H1gsize + L2gsize) / rt_max[2];
+   rates[3] = 1e-6 * alldata[1] * integ_rule.GetNPoints() / rt_max[3];
+   rates[4] = 1e-6 * H1gsize * steps / rt_max[4];
 
    if (IamRoot)
    {
-      const HYPRE_Int H1gsize = H1FESpace.GlobalTrueVSize(),
-                      L2gsize = L2FESpace.GlobalTrueVSize();
       using namespace std;
       cout << endl;
       cout << "CG (H1) total time: " << rt_max[0] << endl;
       cout << "CG (H1) rate (megadofs x cg_iterations / second): "
-           << 1e-6 * H1gsize * timer.H1cg_iter / rt_max[0] << endl;
+           << rates[0] << endl;
       cout << endl;
       cout << "CG (L2) total time: " << rt_max[1] << endl;
       cout << "CG (L2) rate (megadofs x cg_iterations / second): "
-           << 1e-6 * alldata[0] / rt_max[1] << endl;
+           << rates[1] << endl;
       cout << endl;
       // The Force operator is applied twice per time step, on the H1 and the L2
       // vectors, respectively.
       cout << "Forces total time: " << rt_max[2] << endl;
       cout << "Forces rate (megadofs x timesteps / second): "
-           << 1e-6 * steps * (H1gsize + L2gsize) / rt_max[2] << endl;
+           << rates[2] << endl;
+      if (force_otf)
+      {
+         cout << "(includes the stress computations of the on-the-fly force)"
+              << endl;
+      }
       cout << endl;
       cout << "UpdateQuadData total time: " << rt_max[3] << endl;
       cout << "UpdateQuadData rate (megaquads x timesteps / second): "
-           << 1e-6 * alldata[1] * integ_rule.GetNPoints() / rt_max[3] << endl;
+           << rates[3] << endl;
       cout << endl;
       cout << "Major kernels total time (seconds): " << rt_max[4] << endl;
       cout << "Major kernels total rate (megadofs x time steps / second): "
-           << 1e-6 * H1gsize * steps / rt_max[4] << endl;
+           << rates[4] << endl;
+   }
+
+   // Compute and MPI wait times of all timed kernels. The times accumulated
+   // before a restart are not included.
+   const int nk = 6;
+   KernelTimer *kt[nk] = { &timer.sw_cgH1, &timer.sw_cgL2, &timer.sw_force,
+                           &timer.sw_qdata, &timer.sw_dt, &timer.sw_output
+                         };
+   double my_cw[2*nk], cw_min[2*nk], cw_sum[2*nk], cw_max[2*nk];
+   for (int k = 0; k < nk; k++)
+   {
+      my_cw[2*k]   = kt[k]->ComputeTime();
+      my_cw[2*k+1] = kt[k]->WaitTime();
+   }
+   MPI_Reduce(my_cw, cw_min, 2*nk, MPI_DOUBLE, MPI_MIN, 0, comm);
+   MPI_Reduce(my_cw, cw_sum, 2*nk, MPI_DOUBLE, MPI_SUM, 0, comm);
+   MPI_Reduce(my_cw, cw_max, 2*nk, MPI_DOUBLE, MPI_MAX, 0, comm);
+   // Load imbalance: maximum over average compute time (1 is perfect).
+   double imbalance[nk];
+   for (int k = 0; k < nk; k++)
+   {
+      const double avg = cw_sum[2*k] / num_procs;
+      imbalance[k] = (avg > 0.0) ? cw_max[2*k] / avg : 1.0;
+   }
+   const char *kernel_titles[nk] =
+   {
+      "CG (H1)", "CG (L2)", "Forces", "UpdateQuadData", "Time step estimate",
+      "Output"
+   };
+   if (IamRoot)
+   {
+      using namespace std;
+      const ios::fmtflags flags = cout.flags();
+      const streamsize prec = cout.precision();
+      cout << endl << "Kernel compute / MPI wait times (seconds, "
+           << "min avg max) and imbalance (max / avg compute):" << endl;
+      cout << scientific << setprecision(3);
+      for (int k = 0; k < nk; k++)
+      {
+         cout << "  " << left << setw(20) << kernel_titles[k] << right
+              << setw(11) << cw_min[2*k] << setw(11) << cw_sum[2*k] / num_procs
+              << setw(11) << cw_max[2*k] << " |"
+              << setw(11) << cw_min[2*k+1]
+              << setw(11) << cw_sum[2*k+1] / num_procs
+              << setw(11) << cw_max[2*k+1] << " |"
+              << fixed << setprecision(2) << setw(7) << imbalance[k]
+              << scientific << setprecision(3) << endl;
+      }
+      cout.flags(flags);
+      cout.precision(prec);
+   }
+
+   // The rejected steps are the same on all ranks, their time is not.
+   double rejected_time_max;
+   MPI_Reduce(&timer.rejected_time, &rejected_time_max, 1, MPI_DOUBLE,
+              MPI_MAX, 0, comm);
+   if (IamRoot && timer.rejected_steps > 0)
+   {
+      using namespace std;
+      cout << endl << "Rejected time steps: " << timer.rejected_steps
+           << ", time (max over tasks): " << rejected_time_max << endl;
+   }
+
+   // Achieved rates of the partial assembly work of the first four kernels,
+   // from their analytic flop and byte counts summed over the ranks, and the
+   // maximum compute time (MPI wait excluded).
+   const int nc = 4;
+   const KernelCost *kc[nc] = { &timer.cost_cgH1, &timer.cost_cgL2,
+                                &timer.cost_force, &timer.cost_qdata
+                              };
+   double my_cost[2*nc], cost_sum[2*nc], gflops[nc], gbytes[nc];
+   for (int k = 0; k < nc; k++)
+   {
+      my_cost[2*k]   = kc[k]->flops;
+      my_cost[2*k+1] = kc[k]->bytes;
+   }
+   MPI_Reduce(my_cost, cost_sum, 2*nc, MPI_DOUBLE, MPI_SUM, 0, comm);
+   for (int k = 0; k < nc; k++)
+   {
+      const double t = cw_max[2*k];
+      gflops[k] = (t > 0.0) ? 1e-9 * cost_sum[2*k] / t : 0.0;
+      gbytes[k] = (t > 0.0) ? 1e-9 * cost_sum[2*k+1] / t : 0.0;
+   }
+   if (IamRoot && p_assembly)
+   {
+      using namespace std;
+      const ios::fmtflags flags = cout.flags();
+      const streamsize prec = cout.precision();
+      cout << endl << "Partial assembly kernel rates (all tasks, max compute "
+           << "time):" << endl;
+      cout << "  " << left << setw(20) << "" << right << setw(11) << "GFLOP/s"
+           << setw(11) << "GB/s" << setw(11) << "flop/byte" << endl;
+      cout << fixed << setprecision(3);
+      for (int k = 0; k < nc; k++)
+      {
+         cout << "  " << left << setw(20) << kernel_titles[k] << right
+              << setw(11) << gflops[k] << setw(11) << gbytes[k]
+              << setw(11) << cost_sum[2*k] / cost_sum[2*k+1] << endl;
+      }
+      cout.flags(flags);
+      cout.precision(prec);
+   }
+
+   // Hardware counts of the same kernels, summed over the ranks. An event is
+   // reported only if it's available on all ranks.
+   const int ne = HWCounters::NUM_EVENTS;
+   int my_avail[ne], avail[ne];
+   long long my_hwc[nc*ne], hwc[nc*ne];
+   for (int i = 0; i < ne; i++)
+   {
+      my_avail[i] = HWCounters::Available(i);
+      for (int k = 0; k < nc; k++) { my_hwc[k*ne + i] = kt[k]->HWCount(i); }
+   }
+   MPI_Reduce(my_avail, avail, ne, MPI_INT, MPI_MIN, 0, comm);
+   MPI_Reduce(my_hwc, hwc, nc*ne, MPI_LONG_LONG, MPI_SUM, 0, comm);
+   bool hwc_avail = false;
+   for (int i = 0; i < ne; i++) { hwc_avail = hwc_avail || avail[i]; }
+   if (IamRoot && hwc_avail)
+   {
+      using namespace std;
+      const ios::fmtflags flags = cout.flags();
+      const streamsize prec = cout.precision();
+      cout << endl << "Hardware counters (sum over tasks):" << endl;
+      cout << "  " << left << setw(18) << "" << right;
+      for (int k = 0; k < nc; k++) { cout << setw(15) << kernel_titles[k]; }
+      cout << endl << scientific << setprecision(4);
+      for (int i = 0; i < ne; i++)
+      {
+         if (!avail[i]) { continue; }
+         cout << "  " << left << setw(18) << HWCounters::Name(i) << right;
+         for (int k = 0; k < nc; k++)
+         {
+            cout << setw(15) << (double) hwc[k*ne + i];
+         }
+         cout << endl;
+      }
+      if (avail[HWCounters::CYCLES] && avail[HWCounters::INSTRUCTIONS])
+      {
+         cout << "  " << left << setw(18) << "ipc" << right
+              << fixed << setprecision(3);
+         for (int k = 0; k < nc; k++)
+         {
+            const double cycles = hwc[k*ne + HWCounters::CYCLES],
+                         instr  = hwc[k*ne + HWCounters::INSTRUCTIONS];
+            cout << setw(15) << ((cycles > 0.0) ? instr / cycles : 0.0);
+         }
+         cout << endl;
+      }
+      cout.flags(flags);
+      cout.precision(prec);
+   }
+
+   PhaseTimer setup;
+   if (startup) { setup.Append(*startup); }
+   setup.Append(timer.setup);
+   vector<double> ph_min, ph_avg, ph_max;
+   setup.Reduce(comm, ph_min, ph_avg, ph_max);
+   if (IamRoot)
+   {
+      setup.Print("Setup phase times (seconds):", ph_min, ph_avg, ph_max);
+   }
+
+   if (!IamRoot || json == NULL) { return; }
+
+   json->BeginObject("sizes");
+   json->Add("zones", nzones_glob);
+   json->Add("h1_dofs", (long long) H1gsize);
+   json->Add("l2_dofs", (long long) L2gsize);
+   json->Add("quad_points_per_zone", integ_rule.GetNPoints());
+   json->Add("mpi_tasks", num_procs);
+   json->EndObject();
+
+   // The rates refer to the legacy kernels; the compute / wait breakdown also
+   // covers the time step estimate and the output.
+   const char *kernel_names[nk] =
+   {
+      "cg_h1", "cg_l2", "forces", "update_quad_data", "dt_estimate", "output"
+   };
+   const char *rate_units[4] =
+   {
+      "megadofs x cg_iterations / second", "megadofs x cg_iterations / second",
+      "megadofs x timesteps / second", "megaquads x timesteps / second"
+   };
+   json->BeginObject("kernels");
+   for (int k = 0; k < nk; k++)
+   {
+      json->BeginObject(kernel_names[k]);
+      if (k < 4)
+      {
+         json->Add("time_min", rt_min[k]);
+         json->Add("time_mean", rt_sum[k] / num_procs);
+         json->Add("time_max", rt_max[k]);
+         json->Add("rate", rates[k]);
+         json->Add("rate_units", rate_units[k]);
+         if (p_assembly)
+         {
+            json->Add("flops", cost_sum[2*k]);
+            json->Add("bytes", cost_sum[2*k+1]);
+            json->Add("gflops_per_second", gflops[k]);
+            json->Add("gbytes_per_second", gbytes[k]);
+            json->Add("arithmetic_intensity",
+                      cost_sum[2*k] / cost_sum[2*k+1]);
+         }
+         if (hwc_avail)
+         {
+            json->BeginObject("hardware_counters");
+            for (int i = 0; i < ne; i++)
+            {
+               if (avail[i]) { json->Add(HWCounters::Name(i), hwc[k*ne + i]); }
+            }
+            json->EndObject();
+         }
+      }
+      json->Add("compute_min", cw_min[2*k]);
+      json->Add("compute_mean", cw_sum[2*k] / num_procs);
+      json->Add("compute_max", cw_max[2*k]);
+      json->Add("mpi_wait_min", cw_min[2*k+1]);
+      json->Add("mpi_wait_mean", cw_sum[2*k+1] / num_procs);
+      json->Add("mpi_wait_max", cw_max[2*k+1]);
+      json->Add("imbalance", imbalance[k]);
+      json->EndObject();
+   }
+   json->BeginObject("major_kernels");
+   json->Add("time_min", rt_min[4]);
+   json->Add("time_mean", rt_sum[4] / num_procs);
+   json->Add("time_max", rt_max[4]);
+   json->Add("rate", rates[4]);
+   json->Add("rate_units", "megadofs x timesteps / second");
+   json->EndObject();
+   json->EndObject();
+
+   json->BeginObject("counters");
+   json->Add("steps", steps);
+   json->Add("h1_cg_iterations", timer.H1cg_iter);
+   json->Add("l2_dof_iterations", (long long) alldata[0]);
+   json->Add("quad_zone_updates", (long long) alldata[1]);
+   json->Add("quad_data_reuses", timer.quad_reuses);
+   json->Add("rejected_steps", timer.rejected_steps);
+   json->Add("rejected_step_time_max", rejected_time_max);
+   json->EndObject();
+
+   json->BeginArray("setup_phases");
+   for (int i = 0; i <= setup.Size(); i++)
+   {
+      json->BeginObject();
+      json->Add("name", (i < setup.Size()) ? setup.Name(i) : string("Total"));
+      json->Add("time_min", ph_min[i]);
+      json->Add("time_mean", ph_avg[i]);
+      json->Add("time_max", ph_max[i]);
+      json->EndObject();
+   }
+   json->EndArray();
+}
+
+void LagrangianHydroOperator::GetTimingState(Vector &state) const
+{
+   state.SetSize(timing_state_size);
+   state(0) = timer.sw_cgH1.RealTime() + timer.restart_rt[0];
+   state(1) = timer.sw_cgL2.RealTime() + timer.restart_rt[1];
+   state(2) = timer.sw_force.RealTime() + timer.restart_rt[2];
+   state(3) = timer.sw_qdata.RealTime() + timer.restart_rt[3];
+   state(4) = timer.H1cg_iter;
+   state(5) = timer.L2dof_iter;
+   state(6) = timer.quad_tstep;
+   state(7) = timer.rejected_steps;
+   state(8) = timer.rejected_time;
+}
+
+void LagrangianHydroOperator::SetTimingState(const DenseMatrix &states,
+                                             bool same_layout)
+{
+   MFEM_VERIFY(states.Height() == timing_state_size,
+               "Wrong size of the timing state.");
+   int myid;
+   MPI_Comm_rank(H1FESpace.GetComm(), &myid);
+
+   if (same_layout)
+   {
+      for (int i = 0; i < 4; i++) { timer.restart_rt[i] = states(i, myid); }
+      timer.H1cg_iter  = (int) states(4, myid);
+      timer.L2dof_iter = (int) states(5, myid);
+      timer.quad_tstep = (int) states(6, myid);
+      timer.rejected_steps = (int) states(7, myid);
+      timer.rejected_time = states(8, myid);
+      return;
+   }
+
+   // The times are reduced with MPI_MAX and the H1 CG iterations and the
+   // rejected steps are the same on all ranks, while the other counters are
+   // summed over the ranks.
+   timer.rejected_time = 0.0;
+   for (int r = 0; r < states.Width(); r++)
+   {
+      timer.rejected_time = max(timer.rejected_time, states(8, r));
+   }
+   for (int i = 0; i < 4; i++)
+   {
+      timer.restart_rt[i] = 0.0;
+      for (int r = 0; r < states.Width(); r++)
+      {
+         timer.restart_rt[i] = max(timer.restart_rt[i], states(i, r));
+      }
+   }
+   timer.H1cg_iter = (int) states(4, 0);
+   timer.rejected_steps = (int) states(7, 0);
+   timer.L2dof_iter = timer.quad_tstep = 0;
+   if (myid == 0)
+   {
+      for (int r = 0; r < states.Width(); r++)
+      {
+         timer.L2dof_iter += (int) states(5, r);
+         timer.quad_tstep += (int) states(6, r);
+      }
    }
 }
 
 LagrangianHydroOperator::~LagrangianHydroOperator()
 {
+   delete evaluator;
    delete tensors1D;
+   for (int t = 0; t < thread_h1_fec.Size(); t++)
+   {
+      delete thread_h1_fec[t];
+      delete thread_l2_fec[t];
+   }
 }
 
+// Work arrays of UpdateQuadratureBatch() for one thread, sized for batches of
+// up to nzones_batch zones.
+struct LagrangianHydroOperator::BatchWork
+{
+   const int tid;
+   Vector e_vals, e_loc, vector_vals, l2_shape;
+   DenseMatrix Jpi, sgrad_v, Jinv, stress, stressJiT, h1_dshape, vecvalMat;
+   // Positions and velocities of a zone, the input of the partial assembly
+   // evaluation, and the physical positions of the quadrature points.
+   DenseMatrix xv_zone[2], pos;
+   Vector pos_q;
+   Array<int> L2dofs, H1dofs;
+   IsoparametricTransformation T;
+   // Time step estimate, internal energy and smallest Jacobian determinant of
+   // the processed zones.
+   double dt_est, internal_energy, min_detJ;
+
+   double *gamma_b, *rho_b, *e_b, *p_b, *cs_b;
+   // Jacobians of reference->physical transformations for all quadrature
+   // points in the batch, at 2*z for zone z. With partial assembly, the
+   // velocity gradients are evaluated in the same pass and kept at 2*z+1.
+   DenseTensor *Jpr_b;
+
+   BatchWork(int tid_, int dim, int nqp, int h1dofs_cnt, int l2dofs_cnt,
+             double dt_est_)
+      : tid(tid_), e_loc(l2dofs_cnt), vector_vals(h1dofs_cnt * dim),
+        l2_shape(l2dofs_cnt), Jpi(dim), sgrad_v(dim), Jinv(dim), stress(dim),
+        stressJiT(dim), h1_dshape(h1dofs_cnt, dim),
+        vecvalMat(vector_vals.GetData(), h1dofs_cnt, dim), pos(nqp, dim),
+        pos_q(dim), dt_est(dt_est_), internal_energy(0.0),
+        min_detJ(numeric_limits<double>::infinity())
+   {
+      xv_zone[0].SetSize(h1dofs_cnt, dim);
+      xv_zone[1].SetSize(h1dofs_cnt, dim);
+      const int nqp_batch = nqp * nzones_batch;
+      gamma_b = new double[nqp_batch];
+      rho_b   = new double[nqp_batch];
+      e_b     = new double[nqp_batch];
+      p_b     = new double[nqp_batch];
+      cs_b    = new double[nqp_batch];
+      Jpr_b   = new DenseTensor[2 * nzones_batch];
+   }
+
+   ~BatchWork()
+   {
+      delete [] gamma_b;
+      delete [] rho_b;
+      delete [] e_b;
+      delete [] p_b;
+      delete [] cs_b;
+      delete [] Jpr_b;
+   }
+};
+
 void LagrangianHydroOperator::UpdateQuadratureData(const Vector &S) const
 {
-   if (quad_data_is_current) { return; }
+   if (S.GetData() == quad_data_state && quad_data_version == state_version)
+   {
+      quad_data.dt_est = min(quad_data.dt_est, quad_data_dt_est);
+      timer.quad_reuses++;
+      return;
+   }
+   EventTrace::Begin("UpdateQuadratureData");
    timer.sw_qdata.Start();
 
    const int nqp = integ_rule.GetNPoints();
 
-   ParGridFunction x, v, e;
-   Vector* sptr = (Vector*) &S;
-   x.MakeRef(&H1FESpace, *sptr, 0);
-   v.MakeRef(&H1FESpace, *sptr, H1FESpace.GetVSize());
-   e.MakeRef(&L2FESpace, *sptr, 2*H1FESpace.GetVSize());
-   Vector e_vals, e_loc(l2dofs_cnt), vector_vals(h1dofs_cnt * dim);
-   DenseMatrix Jpi(dim), sgrad_v(dim), Jinv(dim), stress(dim), stressJiT(dim),
-               vecvalMat(vector_vals.GetData(), h1dofs_cnt, dim);
-   DenseTensor grad_v_ref(dim, dim, nqp);
-   Array<int> L2dofs, H1dofs;
+   Vector x, v, e;
+   GetStateBlocks(S, x, v, e);
 
    // Batched computations are needed, because hydrodynamic codes usually
    // involve expensive computations of material properties. Although this
    // miniapp uses simple EOS equations, we still want to represent the batched
    // cycle structure.
-   int nzones_batch = 3;
-   const int nbatches =  nzones / nzones_batch + 1; // +1 for the remainder.
-   int nqp_batch = nqp * nzones_batch;
-   double *gamma_b = new double[nqp_batch],
-   *rho_b = new double[nqp_batch],
-   *e_b   = new double[nqp_batch],
-   *p_b   = new double[nqp_batch],
-   *cs_b  = new double[nqp_batch];
-   // Jacobians of reference->physical transformations for all quadrature points
-   // in the batch.
-   DenseTensor *Jpr_b = new DenseTensor[nqp_batch];
-   for (int b = 0; b < nbatches; b++)
-   {
-      int z_id = b * nzones_batch; // Global index over zones.
-      // The last batch might not be full.
-      if (z_id == nzones) { break; }
-      else if (z_id + nzones_batch > nzones)
+   const int nbatches = (nzones + nzones_batch - 1) / nzones_batch;
+   const int nthreads = thread_h1_fec.Size();
+   Vector thread_dt_est(nthreads), thread_energy(nthreads),
+          thread_detJ(nthreads);
+   thread_dt_est = numeric_limits<double>::infinity();
+   thread_energy = 0.0;
+   thread_detJ = numeric_limits<double>::infinity();
+
+   // The batches are distributed over the OpenMP threads. Each thread has its
+   // own work arrays, element transformation and finite elements (see
+   // thread_h1_fec), and its own time step estimate and energy sum, which are
+   // combined in thread order at the end, so the sum doesn't depend on the
+   // timing of the threads; the quadrature data of a zone is written only by
+   // the thread of its batch. Without stored stress (force_otf), only the time
+   // step estimate and the internal energy are computed.
+#ifdef _OPENMP
+   #pragma omp parallel num_threads(nthreads)
+#endif
+   {
+      const int tid = ThreadNum();
+      BatchWork w(tid, dim, nqp, h1dofs_cnt, l2dofs_cnt,
+                  numeric_limits<double>::infinity());
+#ifdef _OPENMP
+      #pragma omp for schedule(static)
+#endif
+      for (int b = 0; b < nbatches; b++)
       {
-         nzones_batch = nzones - z_id;
-         nqp_batch    = nqp * nzones_batch;
+         const int z_first = b * nzones_batch; // Global index over zones.
+         // The last batch might not be full.
+         const int nz = min(nzones_batch, nzones - z_first);
+         UpdateQuadratureBatch(x, v, e, z_first, nz, w,
+                               force_otf ? NULL : &quad_data, z_first);
       }
+      thread_dt_est(tid) = w.dt_est;
+      thread_energy(tid) = w.internal_energy;
+      thread_detJ(tid) = w.min_detJ;
+   }
+   double dt_est = numeric_limits<double>::infinity(), internal_energy = 0.0;
+   quad_data.min_detJ = numeric_limits<double>::infinity();
+   for (int t = 0; t < nthreads; t++)
+   {
+      dt_est = min(dt_est, thread_dt_est(t));
+      internal_energy += thread_energy(t);
+      quad_data.min_detJ = min(quad_data.min_detJ, thread_detJ(t));
+   }
+   quad_data.dt_est = min(quad_data.dt_est, dt_est);
+   quad_data.internal_energy = internal_energy;
+   quad_data_state = S.GetData();
+   quad_data_dt_est = dt_est;
+   quad_data_version = state_version;
+   if (p_assembly) { timer.cost_qdata += QuadratureDataCost(); }
 
-      double min_detJ = numeric_limits<double>::infinity();
-      for (int z = 0; z < nzones_batch; z++)
-      {
-         ElementTransformation *T = H1FESpace.GetElementTransformation(z_id);
-         Jpr_b[z].SetSize(dim, dim, nqp);
+   timer.sw_qdata.Stop();
+   timer.quad_tstep += nzones;
+   EventTrace::End();
+}
 
-         if (p_assembly)
+void LagrangianHydroOperator::UpdateQuadratureBatch(const Vector &x,
+                                                    const Vector &v,
+                                                    const Vector &e,
+                                                    int z_first, int nz,
+                                                    BatchWork &w,
+                                                    QuadratureData *stress_data,
+                                                    int stress_z_first) const
+{
+   const int nqp = integ_rule.GetNPoints();
+   Mesh *mesh = H1FESpace.GetMesh();
+   DenseTensor *Jpr_b = w.Jpr_b;
+
+   double min_detJ = numeric_limits<double>::infinity();
+   for (int z = 0; z < nz; z++)
+   {
+      const int z_id = z_first + z;
+      Jpr_b[2*z].SetSize(dim, dim, nqp);
+
+      if (p_assembly)
+      {
+         // Zone values through the dof maps.
+         const int *l2_map = &l2_zone_dofs[z_id * l2dofs_cnt],
+                    *h1_map = &h1_zone_vdofs[z_id * h1dofs_cnt * dim];
+         for (int j = 0; j < l2dofs_cnt; j++)
+         {
+            w.e_loc(j) = e(l2_map[j]);
+         }
+         double *x_zone = w.xv_zone[0].GetData(),
+                *v_zone = w.xv_zone[1].GetData();
+         for (int j = 0; j < h1dofs_cnt * dim; j++)
          {
-            // Energy values at quadrature point.
-            L2FESpace.GetElementDofs(z_id, L2dofs);
-            e.GetSubVector(L2dofs, e_loc);
-            evaluator->GetL2Values(e_loc, e_vals);
-
-            // All reference->physical Jacobians at the quadrature points.
-            H1FESpace.GetElementVDofs(z_id, H1dofs);
-            x.GetSubVector(H1dofs, vector_vals);
-            evaluator->GetVectorGrad(vecvalMat, Jpr_b[z]);
+            x_zone[j] = x(h1_map[j]);
+            v_zone[j] = v(h1_map[j]);
          }
-         else { e.GetValues(z_id, integ_rule, e_vals); }
+
+         // Energy values, all reference->physical Jacobians and velocity
+         // gradients at the quadrature points, in one pass. The physical
+         // positions of the points are needed only for the material function.
+         evaluator->GetZoneValues(w.e_loc, w.e_vals, 2, w.xv_zone,
+                                  Jpr_b + 2*z, material_pos ? &w.pos : NULL);
+      }
+      else
+      {
+         const int geom = mesh->GetElementBaseGeometry(z_id);
+         const FiniteElement *h1_fe =
+            thread_h1_fec[w.tid]->FiniteElementForGeometry(geom);
+         L2FESpace.GetElementDofs(z_id, w.L2dofs);
+         e.GetSubVector(w.L2dofs, w.e_loc);
+         H1FESpace.GetElementVDofs(z_id, w.H1dofs);
+         x.GetSubVector(w.H1dofs, w.vector_vals);
+
+         // The transformation of the zone, with the thread's element; it's
+         // used only by the material coefficient.
+         w.T.SetFE(h1_fe);
+         w.T.GetPointMat().Transpose(w.vecvalMat);
+         w.T.Attribute = mesh->GetAttribute(z_id);
+         w.T.ElementNo = z_id;
+
+         // The values of the evaluator, from the thread's elements.
+         const FiniteElement *l2_fe =
+            thread_l2_fec[w.tid]->FiniteElementForGeometry(geom);
+         w.e_vals.SetSize(nqp);
          for (int q = 0; q < nqp; q++)
          {
             const IntegrationPoint &ip = integ_rule.IntPoint(q);
-            T->SetIntPoint(&ip);
-            if (!p_assembly) { Jpr_b[z](q) = T->Jacobian(); }
-            const double detJ = Jpr_b[z](q).Det();
-            min_detJ = min(min_detJ, detJ);
-
-            const int idx = z * nqp + q;
-            if (material_pcf == NULL) { gamma_b[idx] = 5./3.; } // Ideal gas.
-            else { gamma_b[idx] = material_pcf->Eval(*T, ip); }
-            rho_b[idx] = quad_data.rho0DetJ0w(z_id*nqp + q) / detJ / ip.weight;
-            e_b[idx]   = max(0.0, e_vals(q));
+            l2_fe->CalcShape(ip, w.l2_shape);
+            w.e_vals(q) = w.l2_shape * w.e_loc;
+            h1_fe->CalcDShape(ip, w.h1_dshape);
+            MultAtB(w.vecvalMat, w.h1_dshape, Jpr_b[2*z](q));
+         }
+      }
+      for (int q = 0; q < nqp; q++)
+      {
+         const IntegrationPoint &ip = integ_rule.IntPoint(q);
+         const double detJ = Jpr_b[2*z](q).Det();
+         min_detJ = min(min_detJ, detJ);
+         w.min_detJ = min(w.min_detJ, detJ);
+
+         const int idx = z * nqp + q;
+         // Ideal gas by default.
+         if (material_pcf == NULL) { w.gamma_b[idx] = 5./3.; }
+         else if (p_assembly)
+         {
+            w.pos.GetRow(q, w.pos_q);
+            w.gamma_b[idx] = material_pos->Eval(w.pos_q);
          }
-         ++z_id;
+         else
+         {
+            w.T.SetIntPoint(&ip);
+            w.gamma_b[idx] = material_pcf->Eval(w.T, ip);
+         }
+         w.rho_b[idx] = quad_data.rho0DetJ0w(z_id*nqp + q) / detJ / ip.weight;
+         w.e_b[idx]   = max(0.0, w.e_vals(q));
+         w.internal_energy += quad_data.rho0DetJ0w(z_id*nqp + q) * w.e_vals(q);
       }
+   }
 
-      // Batched computation of material properties.
-      ComputeMaterialProperties(nqp_batch, gamma_b, rho_b, e_b, p_b, cs_b);
+   // Batched computation of material properties.
+   ComputeMaterialProperties(nqp * nz, w.gamma_b, w.rho_b, w.e_b,
+                             w.p_b, w.cs_b);
 
-      z_id -= nzones_batch;
-      for (int z = 0; z < nzones_batch; z++)
+   for (int z = 0; z < nz; z++)
+   {
+      const int z_id = z_first + z;
+      DenseTensor &grad_v_ref = Jpr_b[2*z + 1];
+      if (!p_assembly && use_viscosity)
       {
-         ElementTransformation *T = H1FESpace.GetElementTransformation(z_id);
-         if (p_assembly)
+         grad_v_ref.SetSize(dim, dim, nqp);
+         H1FESpace.GetElementVDofs(z_id, w.H1dofs);
+         v.GetSubVector(w.H1dofs, w.vector_vals);
+         const FiniteElement *h1_fe = thread_h1_fec[w.tid]->
+            FiniteElementForGeometry(mesh->GetElementBaseGeometry(z_id));
+         for (int q = 0; q < nqp; q++)
          {
-            // All reference->physical Jacobians at the quadrature points.
-            H1FESpace.GetElementVDofs(z_id, H1dofs);
-            v.GetSubVector(H1dofs, vector_vals);
-            evaluator->GetVectorGrad(vecvalMat, grad_v_ref);
+            h1_fe->CalcDShape(integ_rule.IntPoint(q), w.h1_dshape);
+            MultAtB(w.vecvalMat, w.h1_dshape, grad_v_ref(q));
          }
-         for (int q = 0; q < nqp; q++)
+      }
+      for (int q = 0; q < nqp; q++)
+      {
+         // Note that the Jacobian was already computed above. We've chosen
+         // not to store the Jacobians for all batched quadrature points.
+         const DenseMatrix &Jpr = Jpr_b[2*z](q);
+         CalcInverse(Jpr, w.Jinv);
+         const double detJ = Jpr.Det(), rho = w.rho_b[z*nqp + q],
+                      p = w.p_b[z*nqp + q], sound_speed = w.cs_b[z*nqp + q];
+
+         DenseMatrix &stress = w.stress, &sgrad_v = w.sgrad_v;
+         stress = 0.0;
+         for (int d = 0; d < dim; d++) { stress(d, d) = -p; }
+
+         double visc_coeff = 0.0;
+         if (use_viscosity)
          {
-            const IntegrationPoint &ip = integ_rule.IntPoint(q);
-            T->SetIntPoint(&ip);
-            // Note that the Jacobian was already computed above. We've chosen
-            // not to store the Jacobians for all batched quadrature points.
-            const DenseMatrix &Jpr = Jpr_b[z](q);
-            CalcInverse(Jpr, Jinv);
-            const double detJ = Jpr.Det(), rho = rho_b[z*nqp + q],
-                         p = p_b[z*nqp + q], sound_speed = cs_b[z*nqp + q];
-
-            stress = 0.0;
-            for (int d = 0; d < dim; d++) { stress(d, d) = -p; }
-
-            double visc_coeff = 0.0;
-            if (use_viscosity)
+            // Compression-based length scale at the point. The first
+            // eigenvector of the symmetric velocity gradient gives the
+            // direction of maximal compression. This is used to define the
+            // relative change of the initial length scale.
+            mfem::Mult(grad_v_ref(q), w.Jinv, sgrad_v);
+            sgrad_v.Symmetrize();
+            double eig_val_data[3], eig_vec_data[9];
+            if (dim==1)
             {
-               // Compression-based length scale at the point. The first
-               // eigenvector of the symmetric velocity gradient gives the
-               // direction of maximal compression. This is used to define the
-               // relative change of the initial length scale.
-               if (p_assembly)
-               {
-                  mfem::Mult(grad_v_ref(q), Jinv, sgrad_v);
-               }
-               else
-               {
-                  v.GetVectorGradient(*T, sgrad_v);
-               }
-               sgrad_v.Symmetrize();
-               double eig_val_data[3], eig_vec_data[9];
-               if (dim==1)
-               {
-                  eig_val_data[0] = sgrad_v(0, 0);
-                  eig_vec_data[0] = 1.;
-               }
-               else { sgrad_v.CalcEigenvalues(eig_val_data, eig_vec_data); }
-               Vector compr_dir(eig_vec_data, dim);
-               // Computes the initial->physical transformation Jacobian.
-               mfem::Mult(Jpr, quad_data.Jac0inv(z_id*nqp + q), Jpi);
-               Vector ph_dir(dim); Jpi.Mult(compr_dir, ph_dir);
-               // Change of the initial mesh size in the compression direction.
-               const double h = quad_data.h0 * ph_dir.Norml2() /
-                                compr_dir.Norml2();
-
-               // Measure of maximal compression.
-               const double mu = eig_val_data[0];
-               visc_coeff = 2.0 * rho * h * h * fabs(mu);
-               if (mu < 0.0) { visc_coeff += 0.5 * rho * h * sound_speed; }
-               stress.Add(visc_coeff, sgrad_v);
+               eig_val_data[0] = sgrad_v(0, 0);
+               eig_vec_data[0] = 1.;
             }
+            else { sgrad_v.CalcEigenvalues(eig_val_data, eig_vec_data); }
+            Vector compr_dir(eig_vec_data, dim);
+            // Computes the initial->physical transformation Jacobian.
+            mfem::Mult(Jpr, quad_data.Jac0inv(z_id*nqp + q), w.Jpi);
+            Vector ph_dir(dim); w.Jpi.Mult(compr_dir, ph_dir);
+            // Change of the initial mesh size in the compression direction.
+            const double h = quad_data.h0 * ph_dir.Norml2() /
+                             compr_dir.Norml2();
+
+            // Measure of maximal compression.
+            const double mu = eig_val_data[0];
+            visc_coeff = 2.0 * rho * h * h * fabs(mu);
+            if (mu < 0.0) { visc_coeff += 0.5 * rho * h * sound_speed; }
+            stress.Add(visc_coeff, sgrad_v);
+         }
 
-            // Time step estimate at the point. Here the more relevant length
-            // scale is related to the actual mesh deformation; we use the min
-            // singular value of the ref->physical Jacobian. In addition, the
-            // time step estimate should be aware of the presence of shocks.
-            const double h_min =
-               Jpr.CalcSingularvalue(dim-1) / (double) H1FESpace.GetOrder(0);
-            const double inv_dt = sound_speed / h_min +
-                                  2.5 * visc_coeff / rho / h_min / h_min;
-            if (min_detJ < 0.0)
-            {
-               // This will force repetition of the step with smaller dt.
-               quad_data.dt_est = 0.0;
-            }
-            else
-            {
-               quad_data.dt_est = min(quad_data.dt_est, cfl * (1.0 / inv_dt) );
-            }
+         // Time step estimate at the point. Here the more relevant length
+         // scale is related to the actual mesh deformation; we use the min
+         // singular value of the ref->physical Jacobian. In addition, the time
+         // step estimate should be aware of the presence of shocks.
+         const double h_min =
+            Jpr.CalcSingularvalue(dim-1) / (double) H1FESpace.GetOrder(0);
+         const double inv_dt = sound_speed / h_min +
+                               2.5 * visc_coeff / rho / h_min / h_min;
+         if (min_detJ < 0.0)
+         {
+            // This will force repetition of the step with smaller dt.
+            w.dt_est = 0.0;
+         }
+         else
+         {
+            w.dt_est = min(w.dt_est, cfl * (1.0 / inv_dt) );
+         }
+
+         if (stress_data == NULL) { continue; }
 
-            // Quadrature data for partial assembly of the force operator.
-            MultABt(stress, Jinv, stressJiT);
-            stressJiT *= integ_rule.IntPoint(q).weight * detJ;
-            for (int vd = 0 ; vd < dim; vd++)
+         // Quadrature data for partial assembly of the force operator.
+         MultABt(stress, w.Jinv, w.stressJiT);
+         w.stressJiT *= integ_rule.IntPoint(q).weight * detJ;
+         const int s_idx = (stress_z_first + z)*nqp + q;
+         for (int vd = 0 ; vd < dim; vd++)
+         {
+            for (int gd = 0; gd < dim; gd++)
             {
-               for (int gd = 0; gd < dim; gd++)
-               {
-                  quad_data.stressJinvT(vd)(z_id*nqp + q, gd) =
-                     stressJiT(vd, gd);
-               }
+               stress_data->SetStress(vd, gd, s_idx, w.stressJiT(vd, gd));
             }
          }
-         ++z_id;
       }
    }
-   delete [] gamma_b;
-   delete [] rho_b;
-   delete [] e_b;
-   delete [] p_b;
-   delete [] cs_b;
-   delete [] Jpr_b;
-   quad_data_is_current = true;
+}
 
-   timer.sw_qdata.Stop();
-   timer.quad_tstep += nzones;
+void LagrangianHydroOperator::ForceOnTheFly(const Vector &S, const Vector *v_in,
+                                            Vector *rhs, Vector *e_rhs) const
+{
+   EventTrace::Begin("Force (on the fly)");
+   timer.sw_force.Start();
+
+   const int nqp = integ_rule.GetNPoints();
+   Vector x, v, e;
+   GetStateBlocks(S, x, v, e);
+
+   // The force matrix is applied to the constant 1 of the L2 space.
+   Vector one;
+   if (rhs)
+   {
+      one.SetSize(L2FESpace.GetVSize());
+      one = 1.0;
+      *rhs = 0.0;
+   }
+
+   // The stress of one batch at a time, applied by both force actions while
+   // it's in cache. The force accumulates into shared H1 dofs, so the zones
+   // are processed by the calling thread only.
+   BatchWork w(0, dim, nqp, h1dofs_cnt, l2dofs_cnt,
+               numeric_limits<double>::infinity());
+   QuadratureData zone_data(dim, nzones_batch, nqp);
+   for (int z_first = 0; z_first < nzones; z_first += nzones_batch)
+   {
+      const int nz = min(nzones_batch, nzones - z_first);
+      UpdateQuadratureBatch(x, v, e, z_first, nz, w, &zone_data, 0);
+      if (rhs) { ForcePA.AddMultZones(zone_data, z_first, nz, one, *rhs); }
+      if (e_rhs)
+      {
+         ForcePA.MultTransposeZones(zone_data, z_first, nz, *v_in, *e_rhs);
+      }
+   }
+
+   // The rest of the quadrature data comes with it.
+   quad_data.dt_est = min(quad_data.dt_est, w.dt_est);
+   quad_data.internal_energy = w.internal_energy;
+   quad_data.min_detJ = w.min_detJ;
+   quad_data_state = S.GetData();
+   quad_data_dt_est = w.dt_est;
+   quad_data_version = state_version;
+
+   timer.sw_force.Stop();
+   timer.cost_force += QuadratureDataCost();
+   if (rhs) { timer.cost_force += ForcePA.MultCost(); }
+   if (e_rhs) { timer.cost_force += ForcePA.MultTransposeCost(); }
+   EventTrace::End();
+}
+
+KernelCost LagrangianHydroOperator::QuadratureDataCost() const
+{
+   // Energy values, Jacobians, velocity gradients and, for the material
+   // function, positions from the zone dofs, gathered through the dof maps.
+   KernelCost zone(evaluator->GetZoneValuesCost(2, material_pos != NULL));
+   zone.bytes += sizeof(int) * (l2dofs_cnt + dim * h1dofs_cnt);
+
+   // Rough counts of the pointwise work: Jacobian inverse and determinant,
+   // equation of state, time step estimate and the stress products, plus the
+   // velocity gradient eigen-decomposition of the artificial viscosity.
+   const int d3 = dim * dim * dim, d2 = dim * dim;
+   double qp_flops = 10.0 * d3 + 3.0 * d2 + 20.0;
+   double qp_bytes = sizeof(double) + quad_data.StressBytes() * d2;
+   if (use_viscosity)
+   {
+      qp_flops += 14.0 * d3 + 5.0 * d2 + 4.0 * dim + 10.0;
+      qp_bytes += sizeof(double) * d2;
+   }
+   const int nqp = integ_rule.GetNPoints();
+   zone += KernelCost(nqp * qp_flops, nqp * qp_bytes);
+   zone *= nzones;
+   return zone;
 }
 
 } // namespace hydrodynamics
 
 } // namespace mfem
-
-#endif // MFEM_USE_MPI
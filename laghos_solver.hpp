@@ -17,10 +17,10 @@
 #ifndef MFEM_LAGHOS_SOLVER
 #define MFEM_LAGHOS_SOLVER
 
-#include "mfem.hpp"
+#include "laghos_compat.hpp"
 #include "laghos_assembly.hpp"
-
-#ifdef MFEM_USE_MPI
+#include "laghos_timing.hpp"
+#include "laghos_diagnostics.hpp"
 
 #include <memory>
 #include <iostream>
@@ -32,6 +32,32 @@ namespace mfem
 namespace hydrodynamics
 {
 
+// Coefficient given by a function of the position. Besides the usual
+// evaluation in a zone, it can be evaluated directly at physical points, as
+// done by the partial assembly quadrature update. Derived classes can replace
+// the function, e.g., by one with parameters.
+class PositionCoefficient : public Coefficient
+{
+private:
+   double (*Function)(const Vector &);
+
+protected:
+   PositionCoefficient() : Function(NULL) { }
+
+public:
+   PositionCoefficient(double (*f)(const Vector &)) : Function(f) { }
+
+   virtual double Eval(const Vector &x) const { return Function(x); }
+
+   virtual double Eval(ElementTransformation &T, const IntegrationPoint &ip)
+   {
+      double x[3];
+      Vector transip(x, 3);
+      T.Transform(ip, transip);
+      return Eval(transip);
+   }
+};
+
 /// Visualize the given parallel grid function, using a GLVis server on the
 /// specified host and port. Set the visualization window title, and optionally,
 /// its geometry.
@@ -40,17 +66,18 @@ void VisualizeField(socketstream &sock, const char *vishost, int visport,
                     int x = 0, int y = 0, int w = 400, int h = 400,
                     bool vec = false);
 
-// These are defined in laghos.cpp
-double rho0(const Vector &);
-void v0(const Vector &, Vector &);
-double e0(const Vector &);
-double gamma(const Vector &);
+class JSONWriter;
 
 struct TimingData
 {
    // Total times for all major computations:
    // CG solves (H1 and L2) / force RHS assemblies / quadrature computations.
-   StopWatch sw_cgH1, sw_cgL2, sw_force, sw_qdata;
+   // The timers also measure the time spent waiting in MPI calls.
+   KernelTimer sw_cgH1, sw_cgL2, sw_force, sw_qdata;
+
+   // Global reduction of the time step estimate, and the output of the driver
+   // (norms, visualization and field dumps).
+   KernelTimer sw_dt, sw_output;
 
    // These accumulate the total processed dofs or quad points:
    // #(CG iterations) for the H1 CG solve.
@@ -58,8 +85,30 @@ struct TimingData
    // #quads * #(RK sub steps) for the quadrature data computations.
    int H1cg_iter, L2dof_iter, quad_tstep;
 
+   // Quadrature data updates skipped because the data was current.
+   int quad_reuses;
+
+   // Time steps rejected by the time step control and the wall time spent in
+   // them (the step and its time step estimate), counted by the driver.
+   int rejected_steps;
+   double rejected_time;
+
+   // Kernel times accumulated before a restart from a checkpoint, in the order
+   // CG (H1), CG (L2), forces, quadrature data.
+   double restart_rt[4];
+
+   // Analytic flop and byte counts of the partial assembly work done in the
+   // CG (H1), CG (L2), forces and quadrature data kernels, see KernelCost.
+   // Not accumulated with full assembly.
+   KernelCost cost_cgH1, cost_cgL2, cost_force, cost_qdata;
+
+   // Setup phases of the operator constructor.
+   PhaseTimer setup;
+
    TimingData()
-      : H1cg_iter(0), L2dof_iter(0), quad_tstep(0) { }
+      : H1cg_iter(0), L2dof_iter(0), quad_tstep(0),
+        quad_reuses(0), rejected_steps(0), rejected_time(0.0)
+   { for (int i = 0; i < 4; i++) { restart_rt[i] = 0.0; } }
 };
 
 // Given a solutions state (x, v, e), this class performs all necessary
@@ -73,15 +122,27 @@ protected:
    Array<int> &ess_tdofs;
 
    const int dim, nzones, l2dofs_cnt, h1dofs_cnt, source_type;
+   double source_scale;
    const double cfl;
    const bool use_viscosity, p_assembly;
+   // With partial assembly, don't store the stress terms of the force at the
+   // quadrature points; the force actions compute them a batch of zones at a
+   // time instead, see ForceOnTheFly().
+   const bool force_otf;
    const double cg_rel_tol;
    const int cg_max_iter;
    Coefficient *material_pcf;
+   // The material coefficient as a position function; partial assembly needs
+   // it in this form, since it evaluates the material at the positions of the
+   // quadrature points.
+   PositionCoefficient *material_pos;
 
    // Velocity mass matrix and local inverses of the energy mass matrices. These
    // are constant in time, due to the pointwise mass conservation property.
    mutable ParBilinearForm Mv;
+   // Copy of the local velocity mass matrix for full assembly, since the one
+   // in Mv doesn't survive the parallel assembly of the linear systems.
+   SparseMatrix Mv_spmat_copy;
    DenseTensor Me_inv;
 
    // Integration rule for all assemblies.
@@ -90,13 +151,33 @@ protected:
    // Data associated with each quadrature point in the mesh. These values are
    // recomputed at each time step.
    mutable QuadratureData quad_data;
-   mutable bool quad_data_is_current;
+
+   // The state the quadrature data was computed for: its data pointer and the
+   // state version at that time. The version is advanced whenever a state
+   // vector may have been changed in place, so the data of an accepted state
+   // is reused by the first stage of the next step, and data computed for one
+   // buffer is never used for another. The time step estimate of that state
+   // alone is kept, as the data is reused after ResetTimeStepEstimate.
+   mutable const double *quad_data_state;
+   mutable long state_version, quad_data_version;
+   mutable double quad_data_dt_est;
+
+   // Reduction of GetTimeStepEstimate() when the caller gives none, and its
+   // last global smallest Jacobian determinant.
+   mutable GlobalReduction dt_reduction;
+   mutable double glob_min_detJ;
 
    // Force matrix that combines the kinematic and thermodynamic spaces. It is
    // assembled in each time step and then it is used to compute the final
    // right-hand sides for momentum and specific internal energy.
    mutable MixedBilinearForm Force;
 
+   // 1D shape function tables and the zone evaluator of the partial assembly
+   // operators, NULL with full assembly. Owned by this operator, so each
+   // operator in a process, e.g., in an ensemble, has its own.
+   const Tensors1D *tensors1D;
+   const FastEvaluator *evaluator;
+
    // Same as above, but done through partial assembly.
    ForcePAOperator ForcePA;
 
@@ -108,6 +189,15 @@ protected:
    // Linear solver for energy.
    CGSolver locCG;
 
+   // Vector dofs of the H1 space and dofs of the L2 space of all zones, for
+   // the gathers of the partial assembly quadrature update.
+   Array<int> h1_zone_vdofs, l2_zone_dofs;
+
+   // Private copies of the H1 and L2 finite elements for each OpenMP thread of
+   // UpdateQuadratureData. MFEM's elements keep mutable work arrays, so the
+   // threads can't evaluate the shared ones of the spaces.
+   Array<FiniteElementCollection *> thread_h1_fec, thread_l2_fec;
+
    mutable TimingData timer;
 
    void ComputeMaterialProperties(int nvalues, const double gamma[],
@@ -123,47 +213,149 @@ protected:
 
    void UpdateQuadratureData(const Vector &S) const;
 
+   // Work arrays of a thread of the quadrature data computations.
+   struct BatchWork;
+
+   // Computes the quadrature data of the nz zones starting at z_first, for
+   // the state blocks x, v and e. The time step estimate and the internal
+   // energy are accumulated in w. The stress terms of zone z_first + z are
+   // written to zone stress_z_first + z of stress_data, when given.
+   void UpdateQuadratureBatch(const Vector &x, const Vector &v,
+                              const Vector &e, int z_first, int nz,
+                              BatchWork &w, QuadratureData *stress_data,
+                              int stress_z_first) const;
+
+   // The force actions rhs = F 1 and e_rhs = F^T v_in for the state S, with
+   // the stress computed for one batch of zones at a time and applied right
+   // away, so it's never stored for the whole mesh. Either output may be
+   // NULL. Also updates the time step estimate and the internal energy of
+   // quad_data, as UpdateQuadratureData(S) does.
+   void ForceOnTheFly(const Vector &S, const Vector *v_in,
+                      Vector *rhs, Vector *e_rhs) const;
+
+   // x, v and e reference the position, velocity and energy blocks of S.
+   void GetStateBlocks(const Vector &S, Vector &x, Vector &v, Vector &e) const;
+
+   // The linear solves of SolveVelocity() and SolveEnergy(), for the force
+   // actions rhs = F 1 and e_rhs = F^T v. Both overwrite their input.
+   void VelocitySolve(Vector &rhs, Vector &dv) const;
+   void EnergySolve(Vector &e_rhs, Vector &de) const;
+
+   // Cost of one partial assembly UpdateQuadratureData() call.
+   KernelCost QuadratureDataCost() const;
+
 public:
    LagrangianHydroOperator(int size, ParFiniteElementSpace &h1_fes,
                            ParFiniteElementSpace &l2_fes,
                            Array<int> &essential_tdofs, ParGridFunction &rho0,
                            int source_type_, double cfl_,
                            Coefficient *material_, bool visc, bool pa,
-                           double cgt, int cgiter);
+                           bool otf, double cgt, int cgiter);
 
    // Solve for dx_dt, dv_dt and de_dt.
    virtual void Mult(const Vector &S, Vector &dS_dt) const;
 
+   // The parts of Mult(), used by the time integrators of laghos_timeinteg
+   // that treat the position, velocity and energy blocks separately.
+   // Moves the mesh to the positions in S.
+   void UpdateMesh(const Vector &S) const;
+   // Computes dv_dt (size of the H1 space) for the state S.
+   void SolveVelocity(const Vector &S, Vector &dv) const;
+   // Computes de_dt (size of the L2 space) for the state S, using the given
+   // velocity v in the energy equation.
+   void SolveEnergy(const Vector &S, const Vector &v, Vector &de) const;
+   // Computes dv_dt and de_dt for the state S, using the velocity of S in the
+   // energy equation. With force_otf, both force actions share one pass.
+   void SolveVelocityEnergy(const Vector &S, Vector &dv, Vector &de) const;
+
+   int GetH1VSize() const { return H1FESpace.GetVSize(); }
+   int GetL2VSize() const { return L2FESpace.GetVSize(); }
+
    // Calls UpdateQuadratureData to compute the new quad_data.dt_estimate.
-   double GetTimeStepEstimate(const Vector &S) const;
+   // The estimate and the smallest Jacobian determinant of S are added to the
+   // given reduction, after any values the caller put in it, and all of them
+   // are reduced together; without one, an internal reduction is used.
+   // Collective.
+   double GetTimeStepEstimate(const Vector &S,
+                              GlobalReduction *reduction = NULL) const;
+   // Global smallest Jacobian determinant of the quadrature points, for the
+   // state of the last GetTimeStepEstimate().
+   double GetMinDetJ() const { return glob_min_detJ; }
    void ResetTimeStepEstimate() const;
-   void ResetQuadratureData() const { quad_data_is_current = false; }
+   // Marks the quadrature data as outdated, e.g., after the state vectors
+   // were changed in place.
+   void ResetQuadratureData() const { state_version++; }
+
+   // Scales the energy source, e.g., the Taylor-Green source for another gamma,
+   // see ProblemSetup::SourceScale().
+   void SetSourceScale(double scale) { source_scale = scale; }
+
+   // Stores the partial assembly quadrature data in single precision, see
+   // QuadratureData::SetFloat().
+   void UseFloatQuadratureData()
+   {
+      MFEM_VERIFY(p_assembly, "Single precision quadrature data needs "
+                  "partial assembly.");
+      quad_data.SetFloat();
+      ResetQuadratureData();
+   }
+
+   TimingData &GetTimingData() const { return timer; }
+
+   // Local part of the conserved totals of the state S: mass, the dim
+   // components of the momentum, kinetic energy and internal energy. The
+   // internal energy comes from the quadrature data, which is reused by a
+   // following GetTimeStepEstimate(S).
+   void ComputeLocalTotals(const Vector &S, Vector &totals) const;
 
    // The density values, which are stored only at some quadrature points, are
    // projected as a ParGridFunction.
    void ComputeDensity(ParGridFunction &rho);
 
-   void PrintTimingData(bool IamRoot, int steps);
+   // Prints the kernel times and rates, the compute / MPI wait breakdown of the
+   // kernels, the rejected time steps, the achieved GFLOP/s and GB/s of the
+   // kernels with partial assembly, and the setup phase times of the operator.
+   // The startup phases of the driver, if given, are listed before the ones of
+   // the operator. When json is given (on the root rank), the problem sizes,
+   // the kernel statistics over all ranks, the counters and the setup phases
+   // are also added to it. Collective.
+   void PrintTimingData(bool IamRoot, int steps,
+                        const PhaseTimer *startup = NULL,
+                        JSONWriter *json = NULL);
+
+   // Times and counters of the timing data, including the rejected steps,
+   // stored in checkpoints.
+   static const int timing_state_size = 9;
+   void GetTimingState(Vector &state) const;
+   // Restores the timing data from the states of all ranks of the run that
+   // wrote the checkpoint (one state per column). When the number of ranks has
+   // changed, the states are combined so that the reported totals are kept.
+   void SetTimingState(const DenseMatrix &states, bool same_layout);
 
    ~LagrangianHydroOperator();
 };
 
 class TaylorCoefficient : public Coefficient
 {
+   // 1 for gamma = 5/3.
+   const double scale;
+
    virtual double Eval(ElementTransformation &T,
                        const IntegrationPoint &ip)
    {
       Vector x(2);
       T.Transform(ip, x);
-      return 3.0 / 8.0 * M_PI * ( cos(3.0*M_PI*x(0)) * cos(M_PI*x(1)) -
-                                  cos(M_PI*x(0))     * cos(3.0*M_PI*x(1)) );
+      return scale * 3.0 / 8.0 * M_PI *
+             ( cos(3.0*M_PI*x(0)) * cos(M_PI*x(1)) -
+               cos(M_PI*x(0))     * cos(3.0*M_PI*x(1)) );
    }
+
+public:
+   TaylorCoefficient(double scale_ = 1.0) : scale(scale_) { }
 };
 
 } // namespace hydrodynamics
 
 } // namespace mfem
 
-#endif // MFEM_USE_MPI
-
 #endif // MFEM_LAGHOS
@@ -0,0 +1,375 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+
+#include "laghos_timeinteg.hpp"
+#include "laghos_solver.hpp"
+#include <algorithm>
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+void HydroODESolver::Init(TimeDependentOperator &tdop)
+{
+   ODESolver::Init(tdop);
+   hydro_oper = dynamic_cast<LagrangianHydroOperator *>(f);
+   MFEM_VERIFY(hydro_oper, "HydroODESolver expects a LagrangianHydroOperator.");
+}
+
+void HydroODESolver::Step(Vector &S, double &t, double &dt)
+{
+   S_in = S;
+   Advance(S_in, S, t, dt);
+}
+
+// The stages below follow those of the mfem solvers of the same name, with
+// the state x of mfem replaced by S on the right-hand sides and by S_new on
+// the left. The operator marks its quadrature data as outdated after every
+// Mult(), so the stage vectors can be updated in place.
+void ForwardEulerHydroSolver::Advance(const Vector &S, Vector &S_new,
+                                      double &t, double &dt)
+{
+   dS_dt.SetSize(S.Size());
+   S_new.SetSize(S.Size());
+
+   hydro_oper->SetTime(t);
+   hydro_oper->Mult(S, dS_dt);
+   add(S, dt, dS_dt, S_new);
+   t += dt;
+}
+
+void RK2HydroSolver::Advance(const Vector &S, Vector &S_new,
+                             double &t, double &dt)
+{
+   //  0 |
+   //  a |  a
+   // ---+--------
+   //    | 1-b  b      b = 1/(2a)
+   const double b = 0.5/a;
+   dS_dt.SetSize(S.Size());
+   k.SetSize(S.Size());
+   S_new.SetSize(S.Size());
+
+   hydro_oper->SetTime(t);
+   hydro_oper->Mult(S, dS_dt);
+   add(S, a*dt, dS_dt, S_new);
+   hydro_oper->SetTime(t + a*dt);
+   hydro_oper->Mult(S_new, k);
+   add(1.0 - b, dS_dt, b, k, dS_dt);
+   add(S, dt, dS_dt, S_new);
+   t += dt;
+}
+
+void RK3SSPHydroSolver::Advance(const Vector &S, Vector &S_new,
+                                double &t, double &dt)
+{
+   k.SetSize(S.Size());
+   S_new.SetSize(S.Size());
+
+   // S_new = S + dt F(S).
+   hydro_oper->SetTime(t);
+   hydro_oper->Mult(S, k);
+   add(S, dt, k, S_new);
+   // S_new = 3/4 S + 1/4 (S_new + dt F(S_new)).
+   hydro_oper->SetTime(t + dt);
+   hydro_oper->Mult(S_new, k);
+   S_new.Add(dt, k);
+   add(3.0/4.0, S, 1.0/4.0, S_new, S_new);
+   // S_new = 1/3 S + 2/3 (S_new + dt F(S_new)).
+   hydro_oper->SetTime(t + dt/2);
+   hydro_oper->Mult(S_new, k);
+   S_new.Add(dt, k);
+   add(1.0/3.0, S, 2.0/3.0, S_new, S_new);
+   t += dt;
+}
+
+void RK4HydroSolver::Advance(const Vector &S, Vector &S_new,
+                             double &t, double &dt)
+{
+   //   0  |
+   //  1/2 | 1/2
+   //  1/2 |  0   1/2
+   //   1  |  0    0    1
+   // -----+-------------------
+   //      | 1/6  1/3  1/3  1/6
+   y.SetSize(S.Size());
+   k.SetSize(S.Size());
+   S_new.SetSize(S.Size());
+
+   hydro_oper->SetTime(t);
+   hydro_oper->Mult(S, k); // k1
+   add(S, dt/2, k, y);
+   add(S, dt/6, k, S_new);
+
+   hydro_oper->SetTime(t + dt/2);
+   hydro_oper->Mult(y, k); // k2
+   add(S, dt/2, k, y);
+   S_new.Add(dt/3, k);
+
+   hydro_oper->Mult(y, k); // k3
+   add(S, dt, k, y);
+   S_new.Add(dt/3, k);
+
+   hydro_oper->SetTime(t + dt);
+   hydro_oper->Mult(y, k); // k4
+   S_new.Add(dt/6, k);
+   t += dt;
+}
+
+// Verner's RK6(5) pair, the RK6Solver of mfem: the lower triangle of the
+// Butcher matrix by rows, the weights and the stage times.
+static const double rk6_a[28] =
+{
+   .6e-1,
+   .1923996296296296296296296296296296296296e-1,
+   .7669337037037037037037037037037037037037e-1,
+   .35975e-1,
+   0.,
+   .107925,
+   1.318683415233148260919747276431735612861,
+   0.,
+   -5.042058063628562225427761634715637693344,
+   4.220674648395413964508014358283902080483,
+   -41.87259166432751461803757780644346812905,
+   0.,
+   159.4325621631374917700365669070346830453,
+   -122.1192135650100309202516203389242140663,
+   5.531743066200053768252631238332999150076,
+   -54.43015693531650433250642051294142461271,
+   0.,
+   207.0672513650184644273657173866509835987,
+   -158.6108137845899991828742424365058599469,
+   6.991816585950242321992597280791793907096,
+   -.1859723106220323397765171799549294623692e-1,
+   -54.66374178728197680241215648050386959351,
+   0.,
+   207.9528062553893734515824816699834244238,
+   -159.2889574744995071508959805871426654216,
+   7.018743740796944434698170760964252490817,
+   -.1833878590504572306472782005141738268361e-1,
+   -.5119484997882099077875432497245168395840e-3
+};
+static const double rk6_b[8] =
+{
+   .3438957868357036009278820124728322386520e-1,
+   0.,
+   0.,
+   .2582624555633503404659558098586120858767,
+   .4209371189673537150642551514069801967032,
+   4.405396469669310170148836816197095664891,
+   -176.4831190242986576151740942499002125029,
+   172.3641334014150730294022582711902413315
+};
+static const double rk6_c[7] =
+{
+   .6e-1,
+   .9593333333333333333333333333333333333333e-1,
+   .1439,
+   .4973,
+   .9725,
+   .9995,
+   1.
+};
+
+void RK6HydroSolver::Advance(const Vector &S, Vector &S_new,
+                             double &t, double &dt)
+{
+   const int s = 8;
+   y.SetSize(S.Size());
+   for (int i = 0; i < s; i++) { k[i].SetSize(S.Size()); }
+   S_new.SetSize(S.Size());
+
+   hydro_oper->SetTime(t);
+   hydro_oper->Mult(S, k[0]);
+   for (int l = 0, i = 1; i < s; i++)
+   {
+      add(S, rk6_a[l++]*dt, k[0], y);
+      for (int j = 1; j < i; j++) { y.Add(rk6_a[l++]*dt, k[j]); }
+
+      hydro_oper->SetTime(t + rk6_c[i-1]*dt);
+      hydro_oper->Mult(y, k[i]);
+   }
+   add(S, rk6_b[0]*dt, k[0], S_new);
+   for (int i = 1; i < s; i++) { S_new.Add(rk6_b[i]*dt, k[i]); }
+   t += dt;
+}
+
+void RK2AvgSolver::Advance(const Vector &S, Vector &S_new,
+                           double &t, double &dt)
+{
+   const int Vsize = hydro_oper->GetH1VSize();
+   dS_dt.SetSize(S.Size());
+   S_new.SetSize(S.Size());
+
+   // The monolithic BlockVector stores the unknown fields as follows:
+   // (Position, Velocity, Specific Internal Energy).
+   Vector v0, dx_dt, dv_dt, de_dt;
+   v0.SetDataAndSize(S.GetData() + Vsize, Vsize);
+   dx_dt.SetDataAndSize(dS_dt.GetData(), Vsize);
+   dv_dt.SetDataAndSize(dS_dt.GetData() + Vsize, Vsize);
+   de_dt.SetDataAndSize(dS_dt.GetData() + 2*Vsize, hydro_oper->GetL2VSize());
+
+   // In each of the two stages, starting from S and then from S_new:
+   // - Compute dv_dt using the stage state.
+   // - Set dx_dt = V = v0 + 0.5 dt dv_dt, the average velocity of the stage.
+   // - Compute de_dt using the stage state and V.
+   // - Set S_new from S.
+   const double stage_dt[2] = { 0.5 * dt, dt };
+   for (int s = 0; s < 2; s++)
+   {
+      const Vector &S_stage = (s == 0) ? S : S_new;
+      EventTrace::Begin("RK stage");
+      hydro_oper->SetTime(t + s * 0.5 * dt);
+      hydro_oper->UpdateMesh(S_stage);
+      hydro_oper->SolveVelocity(S_stage, dv_dt);
+      add(v0, 0.5 * dt, dv_dt, dx_dt);
+      hydro_oper->SolveEnergy(S_stage, dx_dt, de_dt);
+      EventTrace::End();
+
+      add(S, stage_dt[s], dS_dt, S_new);
+      hydro_oper->ResetQuadratureData();
+   }
+   t += dt;
+}
+
+// Williamson, Low-storage Runge-Kutta schemes, J. Comput. Phys. 35 (1980).
+static const double ls_rk3_a[3] = { 0.0, -5.0/9.0, -153.0/128.0 };
+static const double ls_rk3_b[3] = { 1.0/3.0, 15.0/16.0, 8.0/15.0 };
+static const double ls_rk3_c[3] = { 0.0, 1.0/3.0, 3.0/4.0 };
+
+// Carpenter and Kennedy, Fourth-order 2N-storage Runge-Kutta schemes, NASA
+// TM-109112 (1994).
+static const double ls_rk4_a[5] =
+{
+   0.0,
+   -567301805773.0/1357537059087.0,
+   -2404267990393.0/2016746695238.0,
+   -3550918686646.0/2091501179385.0,
+   -1275806237668.0/842570457699.0
+};
+static const double ls_rk4_b[5] =
+{
+   1432997174477.0/9575080441755.0,
+   5161836677717.0/13612068292357.0,
+   1720146321549.0/2090206949498.0,
+   3134564353537.0/4481467310338.0,
+   2277821191437.0/14882151754819.0
+};
+static const double ls_rk4_c[5] =
+{
+   0.0,
+   1432997174477.0/9575080441755.0,
+   2526269341429.0/6820363962896.0,
+   2006345519317.0/3224310063776.0,
+   2802321613138.0/2924317926251.0
+};
+
+LowStorageRKSolver::LowStorageRKSolver(int order)
+   : stages(order == 3 ? 3 : 5),
+     a(order == 3 ? ls_rk3_a : ls_rk4_a),
+     b(order == 3 ? ls_rk3_b : ls_rk4_b),
+     c(order == 3 ? ls_rk3_c : ls_rk4_c)
+{
+   MFEM_VERIFY(order == 3 || order == 4,
+               "Low-storage Runge-Kutta methods of order 3 and 4 only.");
+}
+
+void LowStorageRKSolver::Advance(const Vector &S, Vector &S_new,
+                                 double &t, double &dt)
+{
+   const int Vsize = hydro_oper->GetH1VSize();
+   dS.SetSize(S.Size());
+   S_new.SetSize(S.Size());
+   dv_dt.SetSize(Vsize);
+   de_dt.SetSize(hydro_oper->GetL2VSize());
+
+   Vector v, dx, dv, de;
+   dx.SetDataAndSize(dS.GetData(), Vsize);
+   dv.SetDataAndSize(dS.GetData() + Vsize, Vsize);
+   de.SetDataAndSize(dS.GetData() + 2*Vsize, de_dt.Size());
+
+   // The first stage reads S and writes S_new, the others update S_new.
+   for (int i = 0; i < stages; i++)
+   {
+      const Vector &S_stage = (i == 0) ? S : S_new;
+      v.SetDataAndSize(S_stage.GetData() + Vsize, Vsize);
+      EventTrace::Begin("RK stage");
+      hydro_oper->SetTime(t + c[i] * dt);
+      hydro_oper->UpdateMesh(S_stage);
+      hydro_oper->SolveVelocityEnergy(S_stage, dv_dt, de_dt);
+      EventTrace::End();
+
+      // dS = a_i dS + dt F(S), where the position part of F(S) is v. The
+      // first stage has a_1 = 0 and overwrites the dS of the previous step.
+      if (i == 0)
+      {
+         dx.Set(dt, v);
+         dv.Set(dt, dv_dt);
+         de.Set(dt, de_dt);
+         add(S, b[i], dS, S_new);
+      }
+      else
+      {
+         dx *= a[i]; dx.Add(dt, v);
+         dv *= a[i]; dv.Add(dt, dv_dt);
+         de *= a[i]; de.Add(dt, de_dt);
+         S_new.Add(b[i], dS);
+      }
+      hydro_oper->ResetQuadratureData();
+   }
+   t += dt;
+}
+
+bool FixedFactorController::Update(double dt_est, double &dt)
+{
+   if (dt_est < dt)
+   {
+      // Repeat (solve again) with a decreased time step - decrease of the
+      // time estimate suggests appearance of oscillations.
+      dt *= 0.85;
+      return false;
+   }
+   if (dt_est > 1.25 * dt) { dt *= 1.02; }
+   return true;
+}
+
+bool PredictiveController::Update(double dt_est, double &dt)
+{
+   if (dt_est < dt)
+   {
+      // The estimate of an oscillating state is not reliable, so the retry
+      // shrinks by at most a factor of 2.
+      dt *= std::max(0.5, std::min(0.85, safety * dt_est / dt));
+      return false;
+   }
+
+   // A decreasing estimate is assumed to keep decreasing geometrically.
+   double dt_pred = dt_est;
+   if (dt_est_old > 0.0 && dt_est < dt_est_old)
+   {
+      dt_pred *= dt_est / dt_est_old;
+   }
+   dt_est_old = dt_est;
+   dt = std::min(safety * dt_pred, max_growth * dt);
+   return true;
+}
+
+} // namespace hydrodynamics
+
+} // namespace mfem
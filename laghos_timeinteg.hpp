@@ -0,0 +1,200 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_TIMEINTEG
+#define MFEM_LAGHOS_TIMEINTEG
+
+#include "laghos_compat.hpp"
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+class LagrangianHydroOperator;
+
+// Base class of the time integrators that work directly with the position,
+// velocity and energy blocks of the state, through the UpdateMesh(),
+// SolveVelocity(), SolveEnergy() and SolveVelocityEnergy() methods of
+// LagrangianHydroOperator. Since dx_dt = v, the position block never needs a
+// stage vector of its own.
+class HydroODESolver : public ODESolver
+{
+protected:
+   LagrangianHydroOperator *hydro_oper;
+
+   // Copy of the state for the in-place Step().
+   Vector S_in;
+
+public:
+   HydroODESolver() : hydro_oper(NULL) { }
+
+   virtual void Init(TimeDependentOperator &tdop);
+
+   // Advances S by dt into S_new, leaving S unchanged, so that a rejected
+   // step can be dropped without restoring the state. S_new must not be S.
+   virtual void Advance(const Vector &S, Vector &S_new,
+                        double &t, double &dt) = 0;
+
+   // In-place version of Advance(), through a copy of S.
+   virtual void Step(Vector &S, double &t, double &dt);
+};
+
+// Out-of-place versions of the explicit Runge-Kutta methods of mfem, with the
+// same stages and arithmetic, so they give the same results. S_new serves as
+// the accumulator of the stages, and the stage derivatives are computed by
+// LagrangianHydroOperator::Mult().
+class ForwardEulerHydroSolver : public HydroODESolver
+{
+protected:
+   Vector dS_dt;
+
+public:
+   virtual void Advance(const Vector &S, Vector &S_new, double &t, double &dt);
+};
+
+// The two stage method with the second stage at t + a dt; a = 1/2 is the
+// midpoint method.
+class RK2HydroSolver : public HydroODESolver
+{
+protected:
+   const double a;
+   Vector dS_dt, k;
+
+public:
+   RK2HydroSolver(double a_ = 2.0/3.0) : a(a_) { }
+
+   virtual void Advance(const Vector &S, Vector &S_new, double &t, double &dt);
+};
+
+// Third order, strong stability preserving.
+class RK3SSPHydroSolver : public HydroODESolver
+{
+protected:
+   Vector k;
+
+public:
+   virtual void Advance(const Vector &S, Vector &S_new, double &t, double &dt);
+};
+
+// The classical fourth order method.
+class RK4HydroSolver : public HydroODESolver
+{
+protected:
+   Vector y, k;
+
+public:
+   virtual void Advance(const Vector &S, Vector &S_new, double &t, double &dt);
+};
+
+// Verner's eight stage, sixth order method, with one derivative vector per
+// stage.
+class RK6HydroSolver : public HydroODESolver
+{
+protected:
+   Vector y, k[8];
+
+public:
+   virtual void Advance(const Vector &S, Vector &S_new, double &t, double &dt);
+};
+
+// Second order Runge-Kutta in which the energy is updated with the average of
+// the velocities at the start and the end of each stage, which makes the
+// scheme conserve the total energy exactly. Keeps only one derivative
+// vector, whose position block holds the averaged velocity.
+class RK2AvgSolver : public HydroODESolver
+{
+protected:
+   Vector dS_dt;
+
+public:
+   virtual void Advance(const Vector &S, Vector &S_new, double &t, double &dt);
+};
+
+// Low-storage explicit Runge-Kutta methods of the 2N type: every stage does
+// dS = a_i dS + dt F(S), S += b_i dS, so that the only full-size vector, in
+// addition to the state, is dS. The stage derivative needs temporary storage
+// only for the velocity and energy blocks. order 3 is the three stage method
+// of Williamson, order 4 the five stage RK4(3)5[2N] method of Carpenter and
+// Kennedy.
+class LowStorageRKSolver : public HydroODESolver
+{
+protected:
+   const int stages;
+   const double *a, *b, *c;
+   Vector dS, dv_dt, de_dt;
+
+public:
+   LowStorageRKSolver(int order);
+
+   virtual void Advance(const Vector &S, Vector &S_new, double &t, double &dt);
+};
+
+// Chooses the time step from the time step estimates of the operator.
+class TimeStepController
+{
+public:
+   virtual ~TimeStepController() { }
+
+   // Called after a step of size dt, with the estimate dt_est of the new
+   // state. Returns true if the step is accepted, and sets dt to the next time
+   // step, or to the size of the retry if the step is rejected.
+   virtual bool Update(double dt_est, double &dt) = 0;
+
+   // History carried from step to step, saved with checkpoints.
+   virtual double GetState() const { return 0.0; }
+   virtual void SetState(double state) { }
+
+   virtual const char *Name() const = 0;
+};
+
+// The original control: a step is rejected when the new estimate is below dt
+// and is retried with 0.85 dt; dt grows by 2% when the estimate exceeds it by
+// more than 25%.
+class FixedFactorController : public TimeStepController
+{
+public:
+   virtual bool Update(double dt_est, double &dt);
+   virtual const char *Name() const { return "fixed factor"; }
+};
+
+// Predictive control that aims to avoid rejections: the estimate is
+// extrapolated to the end of the next step from its rate of change over the
+// last accepted step, and dt is set to a safety fraction of it, growing by at
+// most max_growth per step. A rejected step is retried with at most 0.85 dt,
+// less if the estimate of the rejected state suggests it.
+class PredictiveController : public TimeStepController
+{
+protected:
+   const double safety, max_growth;
+   double dt_est_old;
+
+public:
+   PredictiveController(double safety_ = 0.9, double max_growth_ = 1.05)
+      : safety(safety_), max_growth(max_growth_), dt_est_old(0.0) { }
+
+   virtual bool Update(double dt_est, double &dt);
+   virtual double GetState() const { return dt_est_old; }
+   virtual void SetState(double state) { dt_est_old = state; }
+   virtual const char *Name() const { return "predictive"; }
+};
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_LAGHOS_TIMEINTEG
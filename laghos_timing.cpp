@@ -0,0 +1,548 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#include "laghos_timing.hpp"
+
+#include <iomanip>
+#include <sstream>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Time spent inside the wrapped MPI calls.
+static double mpi_wait_time = 0.0;
+
+#if defined(MFEM_USE_MPI) && !defined(LAGHOS_NO_MPI_PROFILING)
+
+// The blocking MPI calls below are intercepted through the MPI profiling
+// interface: each wrapper calls the PMPI_ version and accumulates its time.
+#if MPI_VERSION >= 3
+#define LAGHOS_MPI_CONST const
+#else
+#define LAGHOS_MPI_CONST
+#endif
+
+#define LAGHOS_MPI_TIMED(call)                   \
+   const double t_start = PMPI_Wtime();          \
+   const int ierr = call;                        \
+   mpi_wait_time += PMPI_Wtime() - t_start;      \
+   return ierr;
+
+int MPI_Allreduce(LAGHOS_MPI_CONST void *sbuf, void *rbuf, int count,
+                  MPI_Datatype type, MPI_Op op, MPI_Comm comm)
+{
+   LAGHOS_MPI_TIMED(PMPI_Allreduce(sbuf, rbuf, count, type, op, comm));
+}
+
+int MPI_Reduce(LAGHOS_MPI_CONST void *sbuf, void *rbuf, int count,
+               MPI_Datatype type, MPI_Op op, int root, MPI_Comm comm)
+{
+   LAGHOS_MPI_TIMED(PMPI_Reduce(sbuf, rbuf, count, type, op, root, comm));
+}
+
+int MPI_Bcast(void *buf, int count, MPI_Datatype type, int root,
+              MPI_Comm comm)
+{
+   LAGHOS_MPI_TIMED(PMPI_Bcast(buf, count, type, root, comm));
+}
+
+int MPI_Barrier(MPI_Comm comm)
+{
+   LAGHOS_MPI_TIMED(PMPI_Barrier(comm));
+}
+
+int MPI_Allgather(LAGHOS_MPI_CONST void *sbuf, int scount, MPI_Datatype stype,
+                  void *rbuf, int rcount, MPI_Datatype rtype, MPI_Comm comm)
+{
+   LAGHOS_MPI_TIMED(PMPI_Allgather(sbuf, scount, stype,
+                                   rbuf, rcount, rtype, comm));
+}
+
+int MPI_Alltoall(LAGHOS_MPI_CONST void *sbuf, int scount, MPI_Datatype stype,
+                 void *rbuf, int rcount, MPI_Datatype rtype, MPI_Comm comm)
+{
+   LAGHOS_MPI_TIMED(PMPI_Alltoall(sbuf, scount, stype,
+                                  rbuf, rcount, rtype, comm));
+}
+
+int MPI_Alltoallv(LAGHOS_MPI_CONST void *sbuf, LAGHOS_MPI_CONST int *scounts,
+                  LAGHOS_MPI_CONST int *sdispls, MPI_Datatype stype,
+                  void *rbuf, LAGHOS_MPI_CONST int *rcounts,
+                  LAGHOS_MPI_CONST int *rdispls, MPI_Datatype rtype,
+                  MPI_Comm comm)
+{
+   LAGHOS_MPI_TIMED(PMPI_Alltoallv(sbuf, scounts, sdispls, stype,
+                                   rbuf, rcounts, rdispls, rtype, comm));
+}
+
+int MPI_Wait(MPI_Request *request, MPI_Status *status)
+{
+   LAGHOS_MPI_TIMED(PMPI_Wait(request, status));
+}
+
+int MPI_Waitall(int count, MPI_Request *requests, MPI_Status *statuses)
+{
+   LAGHOS_MPI_TIMED(PMPI_Waitall(count, requests, statuses));
+}
+
+int MPI_Waitany(int count, MPI_Request *requests, int *index,
+                MPI_Status *status)
+{
+   LAGHOS_MPI_TIMED(PMPI_Waitany(count, requests, index, status));
+}
+
+int MPI_Send(LAGHOS_MPI_CONST void *buf, int count, MPI_Datatype type,
+             int dest, int tag, MPI_Comm comm)
+{
+   LAGHOS_MPI_TIMED(PMPI_Send(buf, count, type, dest, tag, comm));
+}
+
+int MPI_Recv(void *buf, int count, MPI_Datatype type, int source, int tag,
+             MPI_Comm comm, MPI_Status *status)
+{
+   LAGHOS_MPI_TIMED(PMPI_Recv(buf, count, type, source, tag, comm, status));
+}
+
+#undef LAGHOS_MPI_TIMED
+
+#endif // MFEM_USE_MPI && !LAGHOS_NO_MPI_PROFILING
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+double MPIWaitTime() { return mpi_wait_time; }
+
+// The open counters of a thread form one perf event group, read at once
+// through its leader; pos is the position of an event in the group read. A
+// counter of the calling thread only sees the threads it creates when they
+// exit, so every OpenMP thread opens its own group and the counts of the
+// groups are summed. This relies on the OpenMP runtime keeping its threads
+// between parallel regions, as the common runtimes do.
+static const char *hwc_names[HWCounters::NUM_EVENTS] =
+{
+   "cycles", "instructions", "l1d_read_misses", "llc_references",
+   "llc_misses", "raw"
+};
+
+struct HWCounterGroup
+{
+   int fd[HWCounters::NUM_EVENTS], pos[HWCounters::NUM_EVENTS];
+   int leader, size;
+};
+static vector<HWCounterGroup> hwc_groups;
+static bool hwc_enabled = false;
+
+#ifdef __linux__
+// Opens and starts the counters of the calling thread.
+static void OpenCounterGroup(HWCounterGroup &g)
+{
+   g.leader = -1;
+   g.size = 0;
+   for (int i = 0; i < HWCounters::NUM_EVENTS; i++)
+   {
+      g.fd[i] = -1;
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                         PERF_FORMAT_TOTAL_TIME_RUNNING;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.disabled = (g.leader < 0);
+      if (i == HWCounters::CYCLES) { attr.config = PERF_COUNT_HW_CPU_CYCLES; }
+      else if (i == HWCounters::INSTRUCTIONS)
+      {
+         attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      }
+      else if (i == HWCounters::L1D_MISSES)
+      {
+         attr.type = PERF_TYPE_HW_CACHE;
+         attr.config = PERF_COUNT_HW_CACHE_L1D |
+                       (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      }
+      else if (i == HWCounters::LLC_REFERENCES)
+      {
+         attr.config = PERF_COUNT_HW_CACHE_REFERENCES;
+      }
+      else if (i == HWCounters::LLC_MISSES)
+      {
+         attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      }
+      else
+      {
+         const char *raw = getenv("LAGHOS_HWC_RAW");
+         if (raw == NULL || *raw == '\0') { continue; }
+         attr.type = PERF_TYPE_RAW;
+         attr.config = strtoull(raw, NULL, 16);
+      }
+
+      // Count this thread on any CPU.
+      const int fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1,
+                                   g.leader, 0);
+      if (fd < 0) { continue; }
+      if (g.leader < 0) { g.leader = fd; }
+      g.fd[i] = fd;
+      g.pos[i] = g.size++;
+   }
+   if (g.leader < 0) { return; }
+   ioctl(g.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+   ioctl(g.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+#endif
+
+bool HWCounters::Enable()
+{
+   if (Enabled()) { return true; }
+#ifdef __linux__
+#ifdef _OPENMP
+   hwc_groups.resize(omp_get_max_threads());
+#else
+   hwc_groups.resize(1);
+#endif
+   // The groups of threads missing from a smaller team stay closed.
+   for (size_t k = 0; k < hwc_groups.size(); k++)
+   {
+      hwc_groups[k].leader = -1;
+      for (int i = 0; i < NUM_EVENTS; i++) { hwc_groups[k].fd[i] = -1; }
+   }
+#ifdef _OPENMP
+   #pragma omp parallel num_threads(hwc_groups.size())
+   OpenCounterGroup(hwc_groups[omp_get_thread_num()]);
+#else
+   OpenCounterGroup(hwc_groups[0]);
+#endif
+   for (size_t k = 0; k < hwc_groups.size(); k++)
+   {
+      if (hwc_groups[k].leader >= 0) { hwc_enabled = true; }
+   }
+   if (!hwc_enabled) { Disable(); }
+   return hwc_enabled;
+#else
+   return false;
+#endif
+}
+
+void HWCounters::Disable()
+{
+#ifdef __linux__
+   for (size_t k = 0; k < hwc_groups.size(); k++)
+   {
+      for (int i = 0; i < NUM_EVENTS; i++)
+      {
+         if (hwc_groups[k].fd[i] >= 0) { close(hwc_groups[k].fd[i]); }
+      }
+   }
+#endif
+   hwc_groups.clear();
+   hwc_enabled = false;
+}
+
+bool HWCounters::Enabled() { return hwc_enabled; }
+
+bool HWCounters::Available(int event)
+{
+   // Partial sums over the threads would be misleading.
+   if (!hwc_enabled) { return false; }
+   for (size_t k = 0; k < hwc_groups.size(); k++)
+   {
+      if (hwc_groups[k].fd[event] < 0) { return false; }
+   }
+   return true;
+}
+
+const char *HWCounters::Name(int event) { return hwc_names[event]; }
+
+void HWCounters::Read(long long *counts)
+{
+   for (int i = 0; i < NUM_EVENTS; i++) { counts[i] = 0; }
+#ifdef __linux__
+   for (size_t k = 0; k < hwc_groups.size(); k++)
+   {
+      const HWCounterGroup &g = hwc_groups[k];
+      if (g.leader < 0) { continue; }
+      // Group read: number of events, time enabled, time running, counts.
+      unsigned long long buf[3 + NUM_EVENTS];
+      const ssize_t size = (3 + g.size) * sizeof(unsigned long long);
+      if (read(g.leader, buf, size) != size) { continue; }
+      const double scale = (buf[2] > 0) ? double(buf[1]) / buf[2] : 0.0;
+      for (int i = 0; i < NUM_EVENTS; i++)
+      {
+         if (g.fd[i] >= 0)
+         {
+            counts[i] += (long long) (scale * buf[3 + g.pos[i]]);
+         }
+      }
+   }
+#endif
+}
+
+void KernelTimer::ClearCounts()
+{
+   for (int i = 0; i < HWCounters::NUM_EVENTS; i++)
+   {
+      hwc[i] = hwc_start[i] = 0;
+   }
+}
+
+void KernelTimer::AddCounts()
+{
+   long long counts[HWCounters::NUM_EVENTS];
+   HWCounters::Read(counts);
+   for (int i = 0; i < HWCounters::NUM_EVENTS; i++)
+   {
+      hwc[i] += counts[i] - hwc_start[i];
+   }
+}
+
+// Ring buffer of trace events; instant events have a negative duration. The
+// Begin() calls that haven't ended yet are kept on a stack.
+struct TraceEvent
+{
+   const char *name;
+   double ts, dur;
+};
+static vector<TraceEvent> trace_events;
+static long long trace_count = 0;
+static bool trace_on = false;
+static MPI_Comm trace_comm = MPI_COMM_NULL;
+static double trace_t0 = 0.0;
+static const int trace_max_depth = 32;
+static const char *trace_open_name[trace_max_depth];
+static double trace_open_ts[trace_max_depth];
+static int trace_depth = 0;
+
+static void TraceRecord(const char *name, double ts, double dur)
+{
+   TraceEvent &ev = trace_events[trace_count % trace_events.size()];
+   ev.name = name;
+   ev.ts = ts;
+   ev.dur = dur;
+   trace_count++;
+}
+
+void EventTrace::Enable(MPI_Comm comm, int capacity)
+{
+   MFEM_VERIFY(capacity > 0, "The trace needs room for some events.");
+   trace_events.resize(capacity);
+   trace_count = 0;
+   trace_depth = 0;
+   trace_comm = comm;
+   MPI_Barrier(comm);
+   trace_t0 = MPI_Wtime();
+   trace_on = true;
+}
+
+void EventTrace::Disable()
+{
+   trace_on = false;
+   vector<TraceEvent>().swap(trace_events);
+   trace_count = 0;
+}
+
+bool EventTrace::Enabled() { return trace_on; }
+
+void EventTrace::Begin(const char *name)
+{
+   if (!trace_on) { return; }
+   if (trace_depth < trace_max_depth)
+   {
+      trace_open_name[trace_depth] = name;
+      trace_open_ts[trace_depth] = MPI_Wtime() - trace_t0;
+   }
+   trace_depth++;
+}
+
+void EventTrace::End()
+{
+   if (!trace_on || trace_depth == 0) { return; }
+   trace_depth--;
+   if (trace_depth < trace_max_depth)
+   {
+      const double ts = trace_open_ts[trace_depth];
+      TraceRecord(trace_open_name[trace_depth], ts,
+                  MPI_Wtime() - trace_t0 - ts);
+   }
+}
+
+void EventTrace::Mark(const char *name)
+{
+   if (!trace_on) { return; }
+   TraceRecord(name, MPI_Wtime() - trace_t0, -1.0);
+}
+
+void EventTrace::Write(const char *file)
+{
+   if (!trace_on) { return; }
+   int myid;
+   MPI_Comm_rank(trace_comm, &myid);
+
+   // The oldest events are overwritten when the buffer is full.
+   const long long capacity = trace_events.size();
+   const long long first = max(0LL, trace_count - capacity);
+   ostringstream block;
+   block << fixed << setprecision(3);
+   if (myid > 0)
+   {
+      block << ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << myid
+            << ",\"args\":{\"name\":\"rank " << myid << "\"}}";
+   }
+   for (long long i = first; i < trace_count; i++)
+   {
+      const TraceEvent &ev = trace_events[i % capacity];
+      block << ",\n{\"name\":\"" << ev.name << "\",\"pid\":" << myid
+            << ",\"tid\":0,\"ts\":" << 1e6 * ev.ts;
+      if (ev.dur < 0.0) { block << ",\"ph\":\"i\",\"s\":\"p\"}"; }
+      else { block << ",\"ph\":\"X\",\"dur\":" << 1e6 * ev.dur << "}"; }
+   }
+   const string data = block.str();
+   MFEM_VERIFY(data.size() <= INT_MAX, "The local trace exceeds 2 GB.");
+
+   // The root rank writes the header and the footer around the blocks of all
+   // ranks, in rank order.
+   const string header = "{\"traceEvents\":[\n"
+                         "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,"
+                         "\"args\":{\"name\":\"rank 0\"}}";
+   long long loc[2] = { (long long) data.size(), first }, offset = 0, tot[2];
+   MPI_Exscan(loc, &offset, 1, MPI_LONG_LONG, MPI_SUM, trace_comm);
+   if (myid == 0) { offset = 0; }
+   MPI_Allreduce(loc, tot, 2, MPI_LONG_LONG, MPI_SUM, trace_comm);
+
+   MPI_File fh;
+   int err = MPI_File_open(trace_comm, const_cast<char *>(file),
+                           MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                           &fh);
+   MFEM_VERIFY(err == MPI_SUCCESS, "Cannot open the trace file " << file);
+   MPI_File_set_size(fh, 0);
+   MPI_File_write_at_all(fh, (MPI_Offset) (header.size() + offset),
+                         const_cast<char *>(data.data()), (int) data.size(),
+                         MPI_CHAR, MPI_STATUS_IGNORE);
+   if (myid == 0)
+   {
+      ostringstream footer;
+      footer << "\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":"
+             << "{\"dropped_events\":" << tot[1] << "}}\n";
+      const string f = footer.str();
+      MPI_File_write_at(fh, 0, const_cast<char *>(header.data()),
+                        (int) header.size(), MPI_CHAR, MPI_STATUS_IGNORE);
+      MPI_File_write_at(fh, (MPI_Offset) (header.size() + tot[0]),
+                        const_cast<char *>(f.data()), (int) f.size(), MPI_CHAR,
+                        MPI_STATUS_IGNORE);
+   }
+   MPI_File_close(&fh);
+}
+
+void PhaseTimer::Start(const char *name)
+{
+   Stop();
+   current = -1;
+   for (int i = 0; i < Size(); i++)
+   {
+      if (names[i] == name) { current = i; break; }
+   }
+   if (current < 0)
+   {
+      current = Size();
+      names.push_back(name);
+      times.push_back(0.0);
+   }
+   sw.Clear();
+   sw.Start();
+}
+
+void PhaseTimer::Stop()
+{
+   if (current < 0) { return; }
+   sw.Stop();
+   times[current] += sw.RealTime();
+   current = -1;
+}
+
+void PhaseTimer::Append(const PhaseTimer &other)
+{
+   names.insert(names.end(), other.names.begin(), other.names.end());
+   times.insert(times.end(), other.times.begin(), other.times.end());
+}
+
+double PhaseTimer::TotalTime() const
+{
+   double total = 0.0;
+   for (int i = 0; i < Size(); i++) { total += times[i]; }
+   return total;
+}
+
+void PhaseTimer::Reduce(MPI_Comm comm, vector<double> &t_min,
+                        vector<double> &t_avg, vector<double> &t_max) const
+{
+   const int n = Size() + 1;
+   vector<double> my_t(times);
+   my_t.push_back(TotalTime());
+   t_min.resize(n); t_avg.resize(n); t_max.resize(n);
+   MPI_Reduce(&my_t[0], &t_min[0], n, MPI_DOUBLE, MPI_MIN, 0, comm);
+   MPI_Reduce(&my_t[0], &t_avg[0], n, MPI_DOUBLE, MPI_SUM, 0, comm);
+   MPI_Reduce(&my_t[0], &t_max[0], n, MPI_DOUBLE, MPI_MAX, 0, comm);
+   int num_procs;
+   MPI_Comm_size(comm, &num_procs);
+   for (int i = 0; i < n; i++) { t_avg[i] /= num_procs; }
+}
+
+void PhaseTimer::Print(MPI_Comm comm, const char *title, ostream &out) const
+{
+   vector<double> t_min, t_avg, t_max;
+   Reduce(comm, t_min, t_avg, t_max);
+
+   int myid;
+   MPI_Comm_rank(comm, &myid);
+   if (myid == 0) { Print(title, t_min, t_avg, t_max, out); }
+}
+
+void PhaseTimer::Print(const char *title, const vector<double> &t_min,
+                       const vector<double> &t_avg,
+                       const vector<double> &t_max, ostream &out) const
+{
+   const ios::fmtflags flags = out.flags();
+   const streamsize prec = out.precision();
+   out << endl << left << setw(32) << title << right
+       << setw(12) << "min" << setw(12) << "avg" << setw(12) << "max" << endl;
+   out << scientific << setprecision(4);
+   for (int i = 0; i <= Size(); i++)
+   {
+      out << "  " << left << setw(30) << ((i < Size()) ? names[i] : "Total")
+          << right << setw(12) << t_min[i] << setw(12) << t_avg[i]
+          << setw(12) << t_max[i] << endl;
+   }
+   out.flags(flags);
+   out.precision(prec);
+}
+
+} // namespace hydrodynamics
+
+} // namespace mfem
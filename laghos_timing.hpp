@@ -0,0 +1,174 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_TIMING
+#define MFEM_LAGHOS_TIMING
+
+#include "laghos_compat.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// Total time this process has spent inside blocking MPI calls: collectives,
+// waits and blocking point-to-point calls, including the ones made by MFEM
+// and hypre. Measured through the MPI profiling interface, see
+// laghos_timing.cpp; always 0 when LAGHOS_NO_MPI_PROFILING is defined and in
+// builds without MPI.
+double MPIWaitTime();
+
+// Hardware performance counters of the calling thread, read through the Linux
+// perf_event_open interface. The counters are off until Enable() is called;
+// counters that the kernel or the CPU don't provide, e.g., due to the
+// perf_event_paranoid setting, are reported as unavailable and read as 0. The
+// RAW event is a CPU-specific event, e.g., packed FP operations, given as a
+// hexadecimal perf config in the LAGHOS_HWC_RAW environment variable. The
+// counts are summed over the OpenMP threads; an event is available only if it
+// could be opened on all of them.
+class HWCounters
+{
+public:
+   enum Event
+   {
+      CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_REFERENCES, LLC_MISSES, RAW,
+      NUM_EVENTS
+   };
+
+   // Opens and starts the counters. Returns false when none is available.
+   static bool Enable();
+   static void Disable();
+   static bool Enabled();
+
+   static bool Available(int event);
+   static const char *Name(int event);
+
+   // Current counts, scaled for multiplexing.
+   static void Read(long long *counts);
+};
+
+// Stopwatch for a kernel that also measures the part of the kernel's time
+// spent waiting inside MPI calls. The rest is the compute time. When the
+// hardware counters are enabled, it also accumulates their counts.
+class KernelTimer
+{
+private:
+   StopWatch sw;
+   double wait, wait_start;
+   long long hwc[HWCounters::NUM_EVENTS], hwc_start[HWCounters::NUM_EVENTS];
+
+   void ClearCounts();
+   void AddCounts();
+
+public:
+   KernelTimer() : wait(0.0), wait_start(0.0) { ClearCounts(); }
+
+   void Start()
+   {
+      if (HWCounters::Enabled()) { HWCounters::Read(hwc_start); }
+      sw.Start();
+      wait_start = MPIWaitTime();
+   }
+   void Stop()
+   {
+      sw.Stop();
+      wait += MPIWaitTime() - wait_start;
+      if (HWCounters::Enabled()) { AddCounts(); }
+   }
+   void Clear() { sw.Clear(); wait = 0.0; ClearCounts(); }
+
+   double RealTime() { return sw.RealTime(); }
+   double WaitTime() const { return wait; }
+   double ComputeTime() { return sw.RealTime() - wait; }
+   long long HWCount(int event) const { return hwc[event]; }
+};
+
+// Per-rank timeline of named regions, written in the Chrome trace event format
+// (chrome://tracing, Perfetto) with the MPI ranks as processes. The events are
+// kept in a fixed-size ring buffer, so a long run keeps its most recent
+// events, and are written only at the end. Begin/End pairs may be nested; the
+// names must be string literals, since only their pointers are stored. All
+// calls do nothing while the trace is disabled.
+class EventTrace
+{
+public:
+   // Starts tracing with room for the given number of events per rank. The
+   // time stamps of all ranks start at the return of this call. Collective.
+   static void Enable(MPI_Comm comm, int capacity);
+   static void Disable();
+   static bool Enabled();
+
+   static void Begin(const char *name);
+   static void End();
+   // Instant event, e.g., a rejected time step.
+   static void Mark(const char *name);
+
+   // Writes the buffered events of all ranks into one file with collective
+   // MPI-IO writes. Collective.
+   static void Write(const char *file);
+};
+
+// Wall-clock times of named phases, e.g., the setup steps of a run. Starting a
+// phase stops the current one; phases that are started repeatedly accumulate.
+// All ranks must time the same phases in the same order.
+class PhaseTimer
+{
+private:
+   std::vector<std::string> names;
+   std::vector<double> times;
+   StopWatch sw;
+   int current;
+
+public:
+   PhaseTimer() : current(-1) { }
+
+   void Start(const char *name);
+   void Stop();
+
+   // Appends the phases of another timer.
+   void Append(const PhaseTimer &other);
+
+   int Size() const { return (int) names.size(); }
+   const std::string &Name(int i) const { return names[i]; }
+   double Time(int i) const { return times[i]; }
+   double TotalTime() const;
+
+   // Min / avg / max of the phase times over the ranks of comm, on rank 0.
+   // The last entry of each array is the total over all phases. Collective.
+   void Reduce(MPI_Comm comm, std::vector<double> &t_min,
+               std::vector<double> &t_avg, std::vector<double> &t_max) const;
+
+   // Prints the reduced phase times on rank 0. Collective.
+   void Print(MPI_Comm comm, const char *title,
+              std::ostream &out = std::cout) const;
+
+   // Prints phase times reduced with Reduce().
+   void Print(const char *title, const std::vector<double> &t_min,
+              const std::vector<double> &t_avg,
+              const std::vector<double> &t_max,
+              std::ostream &out = std::cout) const;
+};
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_LAGHOS_TIMING
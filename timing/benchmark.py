@@ -0,0 +1,331 @@
+#! /usr/bin/env python
+# -*- coding: iso-8859-1 -*-
+#
+# Laghos benchmark harness.
+#
+# Runs the (method, MPI tasks, order, refinement) sweep described by a spec
+# file, collects the JSON reports of the runs (laghos -json) and writes:
+#
+#   <output>_<method>[_np<np>]  rate tables in the format read by rates.py:
+#                               H1order refs h1_dofs l2_dofs h1_cg_rate
+#                               l2_cg_rate forces_rate update_quad_rate
+#                               total_rate
+#   <output>_results.json       all cases with their sizes, times and rates
+#   <output>_scaling.txt        strong / weak scaling tables, if requested
+#   <output>_runs/              the logs and JSON reports of the runs
+#
+# Usage:
+#   ./benchmark.py specs/2D.json                run the sweep
+#   ./benchmark.py specs/2D.json --dry-run      print the commands only
+#   ./benchmark.py specs/2D.json --report-only  tables from an earlier run
+#   ./benchmark.py specs/2D.json --plot         also plot the rates
+#   ./benchmark.py specs/2D.json --save-baseline base.json
+#   ./benchmark.py specs/2D.json --baseline base.json --tolerance 0.1
+#   ./benchmark.py specs/2D.json --launcher "srun -n {np}"
+#
+# With --baseline, the kernel rates of every case are compared against the
+# matching case of the baseline (a results file of an earlier run) and the
+# script fails if any rate dropped by more than the tolerance.
+#
+# Spec file keys (JSON):
+#   output            prefix of the result files
+#   executable        path to laghos (default: ../laghos)
+#   launcher          MPI launch command, {np} is the number of tasks
+#                     (default: "mpirun -np {np}")
+#   wrapper           optional command placed before laghos, e.g. a binding
+#                     script such as ./bind_ray.sh
+#   mesh, dim         serial mesh and its dimension
+#   zones0            number of zones of the serial mesh
+#   methods           list of "pa" / "fa"
+#   l2_orders         thermodynamic orders; the kinematic order is one higher
+#   ranks             list of MPI task counts, or
+#   nodes, ranks_per_node
+#   serial_refs       list of serial refinement levels, or "auto" for the
+#                     fewest levels that give every task a zone
+#   parallel_refs     list of parallel refinement levels (default: [0])
+#   min_l2_dofs, max_l2_dofs
+#                     exclusive bounds on the global L2 dofs of a case; the
+#                     _per_node variants are multiplied by the number of nodes
+#   options           other laghos options, e.g. "-p 1 -tf 0.8 -ms 10"
+#   study             "sweep" (default), "strong" or "weak"
+#   zones_per_rank    weak scaling: zones per task; the refinements of each
+#                     task count are chosen to match it
+#   description       free text
+
+from __future__ import print_function
+
+import json
+import math
+import os
+import shlex
+import subprocess
+import sys
+from optparse import OptionParser
+
+kernels = ['cg_h1', 'cg_l2', 'forces', 'update_quad_data', 'major_kernels']
+
+def spec_ranks(spec):
+  if 'nodes' in spec:
+    nodes = spec['nodes']
+    if not isinstance(nodes, list): nodes = [nodes]
+    return [(n * spec['ranks_per_node'], n) for n in nodes]
+  ranks = spec.get('ranks', [1])
+  if not isinstance(ranks, list): ranks = [ranks]
+  return [(np, None) for np in ranks]
+
+def dof_limits(spec, nodes):
+  scale = nodes if nodes is not None else 1
+  lo = spec.get('min_l2_dofs', spec.get('min_l2_dofs_per_node', 0) * scale)
+  hi = spec.get('max_l2_dofs',
+                spec.get('max_l2_dofs_per_node', float('inf')) * scale)
+  return lo, hi
+
+def auto_serial_refs(spec, np):
+  refs, zones = 0, spec['zones0']
+  while zones < np:
+    refs += 1
+    zones *= 2**spec['dim']
+  return refs
+
+def enumerate_cases(spec):
+  dim, zones0 = spec['dim'], spec['zones0']
+  study = spec.get('study', 'sweep')
+  cases = []
+  for method in spec['methods']:
+    for np, nodes in spec_ranks(spec):
+      lo, hi = dof_limits(spec, nodes)
+      for l2_order in spec['l2_orders']:
+        if study == 'weak':
+          # One refinement level per task count, if it matches exactly.
+          zones = spec['zones_per_rank'] * np
+          refs = math.log(float(zones) / zones0, 2**dim)
+          if refs < 0 or abs(refs - round(refs)) > 1e-8: continue
+          sref = min(auto_serial_refs(spec, np), int(round(refs)))
+          ref_pairs = [(sref, int(round(refs)) - sref)]
+        else:
+          srefs = spec.get('serial_refs', [0])
+          if srefs == 'auto': srefs = [auto_serial_refs(spec, np)]
+          ref_pairs = [(s, p) for s in srefs
+                       for p in spec.get('parallel_refs', [0])]
+        for sref, pref in ref_pairs:
+          serial_zones = zones0 * 2**(dim * sref)
+          zones = serial_zones * 2**(dim * pref)
+          l2_dofs = zones * (l2_order + 1)**dim
+          if serial_zones < np or not lo < l2_dofs < hi: continue
+          cases.append({'method': method, 'np': np, 'nodes': nodes,
+                        'h1_order': l2_order + 1, 'l2_order': l2_order,
+                        'serial_refs': sref, 'parallel_refs': pref,
+                        'zones': zones})
+  return cases
+
+def case_name(case):
+  return '%s_np%d_Q%dQ%d_rs%d_rp%d' % (case['method'], case['np'],
+                                       case['h1_order'], case['l2_order'],
+                                       case['serial_refs'],
+                                       case['parallel_refs'])
+
+def case_key(case):
+  return (case['method'], case['np'], case['h1_order'], case['l2_order'],
+          case['serial_refs'], case['parallel_refs'])
+
+def case_command(spec, case, json_file):
+  cmd = shlex.split(spec.get('launcher', 'mpirun -np {np}')
+                    .format(np=case['np']))
+  cmd += shlex.split(spec.get('wrapper', ''))
+  cmd += [spec.get('executable', '../laghos'), '-' + case['method'],
+          '-m', spec['mesh'],
+          '-rs', str(case['serial_refs']), '-rp', str(case['parallel_refs']),
+          '-ok', str(case['h1_order']), '-ot', str(case['l2_order']),
+          '-json', json_file]
+  cmd += shlex.split(spec.get('options', ''))
+  return cmd
+
+def run_case(spec, case, run_dir, dry_run):
+  name = case_name(case)
+  json_file = os.path.join(run_dir, name + '.json')
+  cmd = case_command(spec, case, json_file)
+  print(' '.join(cmd))
+  if dry_run: return True
+  with open(os.path.join(run_dir, name + '.log'), 'w') as log:
+    status = subprocess.call(cmd, stdout=log, stderr=subprocess.STDOUT)
+  if status != 0 or not os.path.exists(json_file):
+    print('   failed with status %d, see %s.log' % (status, name))
+    return False
+  with open(json_file) as f: report = json.load(f)
+  case['h1_dofs'] = report['sizes']['h1_dofs']
+  case['l2_dofs'] = report['sizes']['l2_dofs']
+  case['steps'] = report['counters']['steps']
+  case['rates'] = dict((k, report['kernels'][k]['rate']) for k in kernels)
+  case['times'] = dict((k, report['kernels'][k]['time_max'])
+                       for k in kernels)
+  return True
+
+def write_rate_tables(spec, cases):
+  header = ('# H1order refs h1_dofs l2_dofs h1_cg_rate l2_cg_rate '
+            'forces_rate update_quad_rate total_rate\n')
+  ranks = sorted(set(c['np'] for c in cases))
+  tables = {}
+  for c in cases:
+    suffix = '_' + c['method']
+    if len(ranks) > 1: suffix += '_np%d' % c['np']
+    tables.setdefault(spec['output'] + suffix, []).append(c)
+  for name in sorted(tables):
+    with open(name, 'w') as f:
+      f.write(header)
+      for c in tables[name]:
+        f.write('%d %d %d %d %.8f %.8f %.8f %.8f %.8f\n' %
+                ((c['h1_order'], c['serial_refs'] + c['parallel_refs'],
+                  c['h1_dofs'], c['l2_dofs']) +
+                 tuple(c['rates'][k] for k in kernels)))
+    print('Wrote', name)
+
+def scaling_tables(spec, cases):
+  study = spec.get('study', 'sweep')
+  if study not in ('strong', 'weak'): return ''
+  lines = []
+  groups = {}
+  for c in cases:
+    key = (c['method'], c['h1_order'], c['l2_order'])
+    if study == 'strong':
+      key += (c['serial_refs'] + c['parallel_refs'],)
+    groups.setdefault(key, []).append(c)
+  for key in sorted(groups):
+    runs = sorted(groups[key], key=lambda c: c['np'])
+    base = runs[0]
+    lines.append('%s scaling: %s Q%dQ%d%s' %
+                 (study, key[0], key[1], key[2],
+                  ', %d refinements' % key[3] if study == 'strong' else ''))
+    lines.append('%8s %12s %14s %14s %12s' %
+                 ('tasks', 'h1_dofs', 'major time', 'total rate',
+                  'efficiency'))
+    for c in runs:
+      t, t0 = c['times']['major_kernels'], base['times']['major_kernels']
+      if study == 'strong':
+        eff = t0 * base['np'] / (t * c['np'])
+      else:
+        eff = (c['rates']['major_kernels'] / c['np']) / \
+              (base['rates']['major_kernels'] / base['np'])
+      lines.append('%8d %12d %14.4e %14.4e %12.3f' %
+                   (c['np'], c['h1_dofs'], t, c['rates']['major_kernels'],
+                    eff))
+    lines.append('')
+  text = '\n'.join(lines)
+  with open(spec['output'] + '_scaling.txt', 'w') as f: f.write(text)
+  return text
+
+def compare_baseline(cases, baseline_file, tolerance):
+  if not os.path.exists(baseline_file):
+    print('The baseline %s does not exist, create it with --save-baseline.' %
+          baseline_file)
+    return False
+  with open(baseline_file) as f: base = json.load(f)['cases']
+  base = dict((case_key(c), c) for c in base if 'rates' in c)
+  slow = 0
+  print('%-34s %-18s %10s %10s %8s' %
+        ('case', 'kernel', 'baseline', 'current', 'ratio'))
+  for c in cases:
+    b = base.get(case_key(c))
+    if b is None:
+      print('%-34s not in the baseline' % case_name(c))
+      continue
+    for k in kernels:
+      ratio = c['rates'][k] / b['rates'][k] if b['rates'][k] > 0 else 1.0
+      flag = ''
+      if ratio < 1.0 - tolerance:
+        flag = '  SLOWER'
+        slow += 1
+      print('%-34s %-18s %10.3f %10.3f %8.3f%s' %
+            (case_name(c), k, b['rates'][k], c['rates'][k], ratio, flag))
+  if slow > 0:
+    print('%d kernel rates are more than %g%% below the baseline.' %
+          (slow, 100 * tolerance))
+  else:
+    print('All kernel rates are within %g%% of the baseline.' %
+          (100 * tolerance))
+  return slow == 0
+
+def plot_rates(spec, cases):
+  from pylab import figure, get_cmap, savefig
+  cm = get_cmap('Set1')
+  for method in sorted(set(c['method'] for c in cases)):
+    for np in sorted(set(c['np'] for c in cases)):
+      runs = [c for c in cases if c['method'] == method and c['np'] == np]
+      fig = figure(figsize=(10,8))
+      ax = fig.gca()
+      orders = sorted(set(c['h1_order'] for c in runs))
+      for i, p in enumerate(orders):
+        pts = sorted((c['h1_dofs'], c['rates']['major_kernels'])
+                     for c in runs if c['h1_order'] == p)
+        ax.plot([x for x, y in pts], [1e6 * y for x, y in pts], 'o-',
+                label='%s: Q%dQ%d' % (method.upper(), p, p-1),
+                color=cm(i % 9), linewidth=2)
+      ax.grid(True, which='major')
+      ax.grid(True, which='minor')
+      ax.legend(loc='best', prop={'size':18})
+      ax.set_xlabel('H1 DOFs', fontsize=18)
+      ax.set_xscale('log')
+      ax.set_ylabel('[DOFs x time steps] / [seconds]', fontsize=18)
+      ax.set_yscale('log')
+      ax.set_title('Total Rate, %d MPI tasks' % np, fontsize=18)
+      name = '%s_%s_np%d.png' % (spec['output'], method, np)
+      savefig(name, dpi=150, bbox_inches='tight')
+      print('Wrote', name)
+
+def main():
+  parser = OptionParser(usage='%prog [options] spec.json')
+  parser.add_option('--dry-run', action='store_true', default=False,
+                    help='print the commands without running them')
+  parser.add_option('--report-only', action='store_true', default=False,
+                    help='use the results of an earlier run')
+  parser.add_option('--plot', action='store_true', default=False,
+                    help='plot the total rates versus the H1 dofs')
+  parser.add_option('--baseline', metavar='FILE',
+                    help='compare the rates against a results file')
+  parser.add_option('--tolerance', type='float', default=0.1,
+                    help='allowed relative slowdown [default: %default]')
+  parser.add_option('--save-baseline', metavar='FILE',
+                    help='copy the results to a baseline file')
+  parser.add_option('--launcher', metavar='CMD',
+                    help='MPI launch command, overrides the one of the spec')
+  opts, args = parser.parse_args()
+  if len(args) != 1: parser.error('expected one spec file')
+
+  with open(args[0]) as f: spec = json.load(f)
+  if opts.launcher: spec['launcher'] = opts.launcher
+  results_file = spec['output'] + '_results.json'
+
+  failed = 0
+  if opts.report_only:
+    with open(results_file) as f: cases = json.load(f)['cases']
+  else:
+    cases = enumerate_cases(spec)
+    run_dir = spec['output'] + '_runs'
+    if not opts.dry_run and not os.path.isdir(run_dir): os.makedirs(run_dir)
+    for case in cases:
+      if not run_case(spec, case, run_dir, opts.dry_run): failed += 1
+    if opts.dry_run: return 0
+    if failed > 0: print('%d of %d runs failed.' % (failed, len(cases)))
+    with open(results_file, 'w') as f:
+      json.dump({'spec': spec, 'cases': cases}, f, indent=1)
+    print('Wrote', results_file)
+
+  cases = [c for c in cases if 'rates' in c]
+  write_rate_tables(spec, cases)
+  text = scaling_tables(spec, cases)
+  if text: print(text)
+  if opts.plot: plot_rates(spec, cases)
+  if opts.save_baseline and failed > 0:
+    print('Not saving the baseline, since some runs failed.')
+  elif opts.save_baseline:
+    dirname = os.path.dirname(opts.save_baseline)
+    if dirname and not os.path.isdir(dirname): os.makedirs(dirname)
+    with open(opts.save_baseline, 'w') as f:
+      json.dump({'spec': spec, 'cases': cases}, f, indent=1)
+    print('Wrote', opts.save_baseline)
+  ok = failed == 0
+  if opts.baseline:
+    ok = compare_baseline(cases, opts.baseline, opts.tolerance) and ok
+  return 0 if ok else 1
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,169 @@
+#! /usr/bin/env python
+# -*- coding: iso-8859-1 -*-
+#
+# Laghos mixed-precision report.
+#
+# Runs a set of partial assembly problems twice, with the quadrature data
+# stored in double and in single precision (laghos -qf), and compares the two
+# runs:
+#
+#   - the relative difference of the final energy norm |e|,
+#   - the largest relative difference of the kinetic, internal and total
+#     energy over the time steps (laghos -cns 1), at the times of the double
+#     run, with the float run interpolated linearly in time,
+#   - the relative total energy change of each run,
+#   - the time and rate of the major kernels.
+#
+# The logs, JSON reports and conservation files of the runs are kept in
+# <output>_runs/, the table is written to <output>.txt.
+#
+# Usage:
+#   ./precision.py                              run the default problems
+#   ./precision.py --dry-run                    print the commands only
+#   ./precision.py --launcher "srun -n {np}"    MPI launch command
+#   ./precision.py --tolerance 1e-4             fail above this energy error
+
+from __future__ import print_function
+
+import bisect
+import json
+import os
+import re
+import shlex
+import subprocess
+import sys
+from optparse import OptionParser
+
+# name, MPI tasks, laghos options
+problems = [
+  ('sedov_2d', 4, '-p 1 -m ../data/square01_quad.mesh -rs 3 -tf 0.8'),
+  ('sedov_3d', 4, '-p 1 -m ../data/cube01_hex.mesh -rs 1 -tf 0.6'),
+  ('taylor_green_2d', 4, '-p 0 -m ../data/square01_quad.mesh -rs 3 -tf 0.5'),
+  ('taylor_green_3d', 4, '-p 0 -m ../data/cube01_hex.mesh -rs 1 -tf 0.25'),
+]
+
+precisions = [('double', []), ('float', ['-qf'])]
+
+energy_re = re.compile(r'\|e\| = *([-+0-9.eE]+)')
+
+def run_name(problem, precision):
+  return problem + '_' + precision
+
+def run(opts, run_dir, problem, np, options, precision, flags):
+  name = os.path.join(run_dir, run_name(problem, precision))
+  cmd = shlex.split(opts.launcher.format(np=np))
+  cmd += [opts.executable, '-pa'] + shlex.split(options) + flags
+  cmd += ['-cns', '1', '-cnf', name + '_conservation.txt',
+          '-json', name + '.json']
+  print(' '.join(cmd))
+  if opts.dry_run: return None
+  with open(name + '.log', 'w') as log:
+    status = subprocess.call(cmd, stdout=log, stderr=subprocess.STDOUT)
+  if status != 0 or not os.path.exists(name + '.json'):
+    print('   failed with status %d, see %s.log' % (status, name))
+    return None
+  res = {}
+  with open(name + '.log') as f:
+    energies = energy_re.findall(f.read())
+  res['energy_norm'] = float(energies[-1]) if energies else float('nan')
+  with open(name + '.json') as f: report = json.load(f)
+  res['energy_change'] = report.get('energy_change', float('nan'))
+  res['time'] = report['kernels']['major_kernels']['time_max']
+  res['rate'] = report['kernels']['major_kernels']['rate']
+  # Columns: step time mass momentum_* kinetic internal total.
+  res['times'], res['energies'] = [], []
+  with open(name + '_conservation.txt') as f:
+    for line in f:
+      if line.startswith('#'): continue
+      cols = line.split()
+      res['times'].append(float(cols[1]))
+      res['energies'].append([float(c) for c in cols[-3:]])
+  return res
+
+def rel_diff(a, b):
+  scale = max(abs(a), abs(b))
+  return abs(a - b) / scale if scale > 0.0 else 0.0
+
+def interpolate(times, values, t):
+  """Value of the series at time t, linear between the recorded times. The
+  times are increasing and t is within their range."""
+  hi = min(max(bisect.bisect_left(times, t), 1), len(times) - 1)
+  lo = hi - 1
+  if times[hi] == times[lo]: return values[hi]
+  w = (t - times[lo]) / (times[hi] - times[lo])
+  return (1.0 - w) * values[lo] + w * values[hi]
+
+def compare(ref, res):
+  cmp = {'energy_norm': rel_diff(ref['energy_norm'], res['energy_norm'])}
+  # The step sizes depend on the data, so the two runs record their energies at
+  # different times; the float series is interpolated to the times of the
+  # double run, where they overlap.
+  rt = res['times']
+  common = [(t, e) for t, e in zip(ref['times'], ref['energies'])
+            if len(rt) > 1 and rt[0] <= t <= rt[-1]]
+  for i, k in enumerate(['kinetic', 'internal', 'total']):
+    values = [e[i] for e in res['energies']]
+    cmp[k] = max([rel_diff(e[i], interpolate(rt, values, t))
+                  for t, e in common] + [0.0])
+  cmp['steps'] = (len(ref['energies']), len(res['energies']))
+  cmp['speedup'] = ref['time'] / res['time'] if res['time'] > 0.0 else 0.0
+  return cmp
+
+def main():
+  parser = OptionParser(usage='%prog [options]')
+  parser.add_option('--dry-run', action='store_true', default=False,
+                    help='print the commands without running them')
+  parser.add_option('--launcher', default='mpirun -np {np}', metavar='CMD',
+                    help='MPI launch command, {np} is the number of tasks '
+                         '[default: %default]')
+  parser.add_option('--executable', default='../laghos', metavar='FILE',
+                    help='path to laghos [default: %default]')
+  parser.add_option('--output', default='precision', metavar='PREFIX',
+                    help='prefix of the result files [default: %default]')
+  parser.add_option('--tolerance', type='float', default=None,
+                    help='fail if the relative difference of |e| or of the '
+                         'total energy exceeds this value')
+  opts, args = parser.parse_args()
+  if args: parser.error('unexpected arguments')
+
+  run_dir = opts.output + '_runs'
+  if not opts.dry_run and not os.path.isdir(run_dir): os.makedirs(run_dir)
+
+  rows, failed = [], 0
+  for problem, np, options in problems:
+    res = {}
+    for precision, flags in precisions:
+      res[precision] = run(opts, run_dir, problem, np, options,
+                           precision, flags)
+    if opts.dry_run: continue
+    if res['double'] is None or res['float'] is None:
+      failed += 1
+      continue
+    rows.append((problem, res['double'], res['float'],
+                 compare(res['double'], res['float'])))
+  if opts.dry_run: return 0
+
+  lines = ['# problem   err_|e|   err_kinetic   err_internal   err_total'
+           '   drift_double   drift_float   steps_double   steps_float'
+           '   time_double   time_float   speedup']
+  ok = failed == 0
+  for problem, ref, res, cmp in rows:
+    lines.append('%-16s %.3e %.3e %.3e %.3e %.3e %.3e %d %d %.4f %.4f %.3f' %
+                 (problem, cmp['energy_norm'], cmp['kinetic'],
+                  cmp['internal'], cmp['total'], ref['energy_change'],
+                  res['energy_change'], cmp['steps'][0], cmp['steps'][1],
+                  ref['time'], res['time'], cmp['speedup']))
+    if opts.tolerance is not None and \
+       max(cmp['energy_norm'], cmp['total']) > opts.tolerance:
+      print('%s: the float run differs by more than %g.' %
+            (problem, opts.tolerance))
+      ok = False
+  if failed > 0: print('%d of %d problems failed.' % (failed, len(problems)))
+  text = '\n'.join(lines) + '\n'
+  print(text, end='')
+  with open(opts.output + '.txt', 'w') as f: f.write(text)
+  print('Wrote', opts.output + '.txt')
+  return 0 if ok else 1
+
+if __name__ == '__main__':
+  sys.exit(main())